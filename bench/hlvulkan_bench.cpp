@@ -0,0 +1,524 @@
+// Headless benchmarks of the library's hot paths, results are written as JSON.
+//
+// Usage: hlvulkan_bench [--device <name substring>] [--iterations <count>] [--output <file>]
+//
+// No surface or window is needed, so it runs against software implementations as well. To use lavapipe for instance:
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./hlvulkan_bench --output bench.json
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+#include "buffer.hpp"
+#include "command_pool.hpp"
+#include "device.hpp"
+#include "image.hpp"
+#include "pipeline_factory.hpp"
+#include "pipeline_spec.hpp"
+#include "queue.hpp"
+#include "render_pass_factory.hpp"
+#include "render_pass_spec.hpp"
+#include "resource_pool.hpp"
+#include "shader_archive.hpp"
+#include "shader_library.hpp"
+#include "vertex_format.hpp"
+
+using namespace HLVulkan;
+
+namespace {
+
+    // Minimal hand-assembled SPIR-V: void main() {} as a vertex shader and as a fragment shader
+    const std::vector<uint32_t> VERTEX_SPIRV = {
+        0x07230203, 0x00010000, 0x00000000, 5, 0,    // Header: magic, version 1.0, generator, id bound, schema
+        0x00020011, 1,                               // OpCapability Shader
+        0x0003000e, 0, 1,                            // OpMemoryModel Logical GLSL450
+        0x0005000f, 0, 1, 0x6e69616d, 0x00000000,    // OpEntryPoint Vertex %1 "main"
+        0x00020013, 2,                               // %2 = OpTypeVoid
+        0x00030021, 3, 2,                            // %3 = OpTypeFunction %2
+        0x00050036, 2, 1, 0, 3,                      // %1 = OpFunction %2 None %3
+        0x000200f8, 4,                               // %4 = OpLabel
+        0x000100fd,                                  // OpReturn
+        0x00010038,                                  // OpFunctionEnd
+    };
+    const std::vector<uint32_t> FRAGMENT_SPIRV = {
+        0x07230203, 0x00010000, 0x00000000, 5, 0,    // Header
+        0x00020011, 1,                               // OpCapability Shader
+        0x0003000e, 0, 1,                            // OpMemoryModel Logical GLSL450
+        0x0005000f, 4, 1, 0x6e69616d, 0x00000000,    // OpEntryPoint Fragment %1 "main"
+        0x00030010, 1, 7,                            // OpExecutionMode %1 OriginUpperLeft
+        0x00020013, 2,                               // %2 = OpTypeVoid
+        0x00030021, 3, 2,                            // %3 = OpTypeFunction %2
+        0x00050036, 2, 1, 0, 3,                      // %1 = OpFunction %2 None %3
+        0x000200f8, 4,                               // %4 = OpLabel
+        0x000100fd,                                  // OpReturn
+        0x00010038,                                  // OpFunctionEnd
+    };
+
+    const std::string VERTEX_SHADER_NAME = "bench.vert";
+    const std::string FRAGMENT_SHADER_NAME = "bench.frag";
+
+    class BenchVertexFormat : public VertexFormat {
+      private:
+        std::vector<VkVertexInputAttributeDescription> createAttributeDescriptions() const override {
+            return {{0, 0, VK_FORMAT_R32G32_SFLOAT, 0}};
+        }
+        VkVertexInputBindingDescription createBindingDescription() const override { return {0, 2 * sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX}; }
+    };
+
+    class BenchPipelineSpec : public PipelineSpec {
+      public:
+        // Varying the depth bias makes every spec a different pipeline as far as deduplication is concerned, unlike varying the extent of a
+        // spec with a dynamic viewport and scissor
+        explicit BenchPipelineSpec(float depthBias = 0.f, uint32_t extent = 256, bool dynamicViewport = false)
+            : depthBias(depthBias), extent(extent), dynamicViewport(dynamicViewport) {}
+
+      private:
+        const float depthBias;
+        const uint32_t extent;
+        const bool dynamicViewport;
+
+        std::vector<ShaderStage> createShaderStages() const override {
+            return {{VERTEX_SHADER_NAME, VK_SHADER_STAGE_VERTEX_BIT}, {FRAGMENT_SHADER_NAME, VK_SHADER_STAGE_FRAGMENT_BIT}};
+        }
+
+        VkPipelineInputAssemblyStateCreateInfo createInputAssembly() const override {
+            VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+            inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+            inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+            return inputAssembly;
+        }
+        std::vector<VkViewport> createViewports() const override { return {{0.f, 0.f, static_cast<float>(extent), static_cast<float>(extent), 0.f, 1.f}}; }
+        std::vector<VkRect2D> createScissors() const override { return {{{0, 0}, {extent, extent}}}; }
+        VkPipelineRasterizationStateCreateInfo createRasterizer() const override {
+            VkPipelineRasterizationStateCreateInfo rasterizer = {};
+            rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+            rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+            rasterizer.cullMode = VK_CULL_MODE_NONE;
+            rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+            rasterizer.depthBiasEnable = VK_TRUE;
+            rasterizer.depthBiasConstantFactor = depthBias;
+            rasterizer.lineWidth = 1.f;
+            return rasterizer;
+        }
+        VkPipelineMultisampleStateCreateInfo createMultisampling() const override {
+            VkPipelineMultisampleStateCreateInfo multisampling = {};
+            multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+            multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+            return multisampling;
+        }
+        std::vector<VkPipelineColorBlendAttachmentState> createColorBlending() const override {
+            VkPipelineColorBlendAttachmentState attachment = {};
+            attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+            return {attachment};
+        }
+        std::vector<VkDescriptorSetLayout> createDescriptorSetLayouts() const override { return {}; }
+        VkPipelineDepthStencilStateCreateInfo createDepthStencil() const override {
+            VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+            depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+            return depthStencil;
+        }
+        std::vector<VkDynamicState> createDynamicStates() const override {
+            if (!dynamicViewport) {
+                return {};
+            }
+            return {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        }
+    };
+
+    // A single color attachment, cleared then stored
+    class BenchRenderPassSpec : public RenderPassSpec {
+      private:
+        const VkAttachmentReference colorReference = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+        std::vector<VkAttachmentDescription> createAttachments() const override {
+            VkAttachmentDescription attachment = {};
+            attachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+            attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            return {attachment};
+        }
+        std::vector<VkSubpassDescription> createSubpasses() const override {
+            VkSubpassDescription subpass = {};
+            subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            subpass.colorAttachmentCount = 1;
+            subpass.pColorAttachments = &colorReference;
+            return {subpass};
+        }
+        std::vector<VkSubpassDependency> createDependencies() const override { return {}; }
+    };
+
+    struct BenchResult {
+        std::string name;
+        uint32_t iterations;
+        double minNs;
+        double medianNs;
+        double meanNs;
+        uint64_t bytes; // Bytes processed per iteration, 0 when not a bandwidth benchmark
+    };
+
+    // Runs setup (untimed) then body (timed) for each iteration
+    BenchResult measure(const std::string &name, uint32_t iterations, uint64_t bytes, const std::function<void()> &setup,
+                        const std::function<void()> &body) {
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        for (uint32_t i = 0; i < iterations; i++) {
+            setup();
+            auto start = std::chrono::steady_clock::now();
+            body();
+            samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.;
+        for (double sample : samples) {
+            sum += sample;
+        }
+        std::cerr << name << ": " << samples[samples.size() / 2] / 1000. << " us median" << std::endl;
+        return {name, iterations, samples.front(), samples[samples.size() / 2], sum / samples.size(), bytes};
+    }
+
+    BenchResult measure(const std::string &name, uint32_t iterations, uint64_t bytes, const std::function<void()> &body) {
+        return measure(name, iterations, bytes, []() {}, body);
+    }
+
+    std::string escapeJson(const std::string &value) {
+        std::string escaped;
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    std::string toJson(const VkPhysicalDeviceProperties &properties, const std::vector<BenchResult> &results) {
+        std::ostringstream json;
+        json << std::fixed << std::setprecision(1);
+        json << "{\n";
+        json << "  \"device\": \"" << escapeJson(properties.deviceName) << "\",\n";
+        json << "  \"vendorID\": " << properties.vendorID << ",\n";
+        json << "  \"driverVersion\": " << properties.driverVersion << ",\n";
+        json << "  \"apiVersion\": \"" << (properties.apiVersion >> 22 & 0x7f) << "." << (properties.apiVersion >> 12 & 0x3ff) << "."
+             << (properties.apiVersion & 0xfff) << "\",\n";
+        json << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult &result = results[i];
+            json << "    {\"name\": \"" << escapeJson(result.name) << "\", \"iterations\": " << result.iterations << ", \"min_ns\": " << result.minNs
+                 << ", \"median_ns\": " << result.medianNs << ", \"mean_ns\": " << result.meanNs;
+            if (result.bytes) {
+                json << ", \"bytes\": " << result.bytes << ", \"median_mib_per_s\": " << (result.bytes / (1024. * 1024.)) / (result.medianNs * 1e-9);
+            }
+            json << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        json << "  ]\n}\n";
+        return json.str();
+    }
+
+    struct Options {
+        std::string deviceName;
+        uint32_t iterations = 100;
+        std::string output;
+    };
+
+    bool parseOptions(int argc, char **argv, Options &options) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                return false;
+            }
+            if (arg == "--device") {
+                options.deviceName = argv[++i];
+            } else if (arg == "--iterations") {
+                options.iterations = std::max(1, std::atoi(argv[++i]));
+            } else if (arg == "--output") {
+                options.output = argv[++i];
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Instance and device without any window system extension
+    struct HeadlessContext {
+        VkInstance instance = VK_NULL_HANDLE;
+        VkPhysicalDevice physical = VK_NULL_HANDLE;
+        VkDevice logical = VK_NULL_HANDLE;
+        VkQueue queue = VK_NULL_HANDLE;
+        uint32_t queueFamily = 0;
+        uint32_t apiVersion = VK_API_VERSION_1_0;
+
+        VkResult create(const std::string &deviceName) {
+            VkApplicationInfo appInfo = {};
+            appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+            appInfo.pApplicationName = "hlvulkan_bench";
+            appInfo.apiVersion = apiVersion;
+
+            VkInstanceCreateInfo instanceInfo = {};
+            instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+            instanceInfo.pApplicationInfo = &appInfo;
+            VK_CHECK_RET(vkCreateInstance(&instanceInfo, nullptr, &instance));
+
+            uint32_t count = 0;
+            VK_CHECK_RET(vkEnumeratePhysicalDevices(instance, &count, nullptr));
+            std::vector<VkPhysicalDevice> physicalDevices(count);
+            VK_CHECK_RET(vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data()));
+
+            for (VkPhysicalDevice candidate : physicalDevices) {
+                VkPhysicalDeviceProperties properties;
+                vkGetPhysicalDeviceProperties(candidate, &properties);
+                if (!deviceName.empty() && std::string(properties.deviceName).find(deviceName) == std::string::npos) {
+                    continue;
+                }
+
+                uint32_t familyCount = 0;
+                vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, nullptr);
+                std::vector<VkQueueFamilyProperties> families(familyCount);
+                vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, families.data());
+                for (uint32_t i = 0; i < familyCount; i++) {
+                    if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                        physical = candidate;
+                        queueFamily = i;
+                        break;
+                    }
+                }
+                if (physical != VK_NULL_HANDLE) {
+                    break;
+                }
+            }
+            if (physical == VK_NULL_HANDLE) {
+                return VK_ERROR_INITIALIZATION_FAILED;
+            }
+
+            float priority = 1.f;
+            VkDeviceQueueCreateInfo queueInfo = {};
+            queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queueInfo.queueFamilyIndex = queueFamily;
+            queueInfo.queueCount = 1;
+            queueInfo.pQueuePriorities = &priority;
+
+            VkDeviceCreateInfo deviceInfo = {};
+            deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+            deviceInfo.queueCreateInfoCount = 1;
+            deviceInfo.pQueueCreateInfos = &queueInfo;
+            VK_CHECK_RET(vkCreateDevice(physical, &deviceInfo, nullptr, &logical));
+
+            vkGetDeviceQueue(logical, queueFamily, 0, &queue);
+            return VK_SUCCESS;
+        }
+
+        ~HeadlessContext() {
+            if (logical != VK_NULL_HANDLE) {
+                vkDestroyDevice(logical, nullptr);
+            }
+            if (instance != VK_NULL_HANDLE) {
+                vkDestroyInstance(instance, nullptr);
+            }
+        }
+    };
+
+    std::vector<BenchResult> runBenchmarks(Device &device, Queue queue, uint32_t iterations) {
+
+        std::vector<BenchResult> results;
+        CommandPool commandPool{device, queue};
+
+        const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        const VkDeviceSize uploadSize = 16 * 1024 * 1024;
+        std::vector<char> uploadData(uploadSize, 0x5a);
+
+        // Buffer creation and binding
+        results.push_back(measure("buffer_create_bind_64k", iterations, 0, [&]() {
+            Buffer buffer{device, 64 * 1024, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+        }));
+
+        // Host to mapped memory
+        {
+            Buffer staging{device, uploadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, hostVisible};
+            results.push_back(measure("map_and_copy_16m", iterations, uploadSize, [&]() { staging.mapAndCopy(uploadData.data(), uploadSize); }));
+
+            Buffer persistent{device, uploadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, hostVisible, true};
+            results.push_back(
+                measure("map_and_copy_persistent_16m", iterations, uploadSize, [&]() { persistent.mapAndCopy(uploadData.data(), uploadSize); }));
+        }
+
+        // Uploads through the blocking helpers
+        {
+            Buffer staging{device, uploadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, hostVisible};
+            staging.mapAndCopy(uploadData.data(), uploadSize);
+            Buffer deviceLocal{device, uploadSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+            results.push_back(measure("buffer_copy_to_16m", iterations, uploadSize, [&]() { staging.copyTo(deviceLocal, commandPool); }));
+
+            const VkExtent2D extent = {2048, 2048}; // 16 MiB of RGBA8
+            Image image{device,
+                        extent,
+                        VK_FORMAT_R8G8B8A8_UNORM,
+                        VK_IMAGE_TILING_OPTIMAL,
+                        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                        VK_IMAGE_ASPECT_COLOR_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+            results.push_back(measure(
+                "image_copy_from_buffer_16m", iterations, uploadSize,
+                [&]() { image.transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, commandPool); },
+                [&]() { image.copyFromBuffer(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, staging, commandPool); }));
+
+            results.push_back(measure("transition_image_layout", iterations, 0, [&]() {
+                image.transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, commandPool);
+            }));
+        }
+
+        // A frame worth of command buffers recycled by a pool reset, only the first frame allocates
+        results.push_back(measure("command_buffer_frame_16", iterations, 0, [&]() {
+            for (int i = 0; i < 16; i++) {
+                commandPool.acquireCommandBuffer();
+            }
+            commandPool.reset();
+        }));
+
+        // Shader modules, a fresh library each time so that nothing is deduplicated
+        const char *vertexCode = reinterpret_cast<const char *>(VERTEX_SPIRV.data());
+        const size_t vertexSize = VERTEX_SPIRV.size() * sizeof(uint32_t);
+        results.push_back(measure("shader_module_create", iterations, 0, [&]() {
+            ShaderLibrary library{device.logical};
+            library.loadCode(vertexCode, vertexSize);
+        }));
+        results.push_back(measure("shader_library_hit", iterations, 0, [&]() { device.getShaderLibrary().loadCode(vertexCode, vertexSize); }));
+
+        // Render passes
+        BenchRenderPassSpec renderPassSpec;
+        results.push_back(measure("render_pass_create", iterations, 0, [&]() {
+            VkRenderPass renderPass = RenderPassFactory::createRenderPass(device, renderPassSpec);
+            vkDestroyRenderPass(device.logical, renderPass, nullptr);
+        }));
+
+        RenderPassFactory renderPassFactory{device};
+        VkRenderPass renderPass = renderPassFactory.generateNewRenderPass(renderPassSpec);
+        results.push_back(measure("render_pass_factory_dedup_hit", iterations, 0, [&]() {
+            renderPassFactory.destroyRenderPass(renderPassFactory.generateNewRenderPass(renderPassSpec));
+        }));
+
+        // Framebuffers, created on the first request then served from the device's cache
+        {
+            const VkExtent2D extent = {1920, 1080};
+            Image target{device,
+                         extent,
+                         VK_FORMAT_R8G8B8A8_UNORM,
+                         VK_IMAGE_TILING_OPTIMAL,
+                         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                         VK_IMAGE_ASPECT_COLOR_BIT,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+            results.push_back(measure("framebuffer_cache_hit", iterations, 0,
+                                      [&]() { device.getFramebufferCache().getFramebuffer(renderPass, {target.getView()}, extent); }));
+
+            // Render targets, created from scratch then recycled (no reuse delay, nothing is in flight here)
+            const VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            results.push_back(measure("image_create_1080p", iterations, 0, [&]() {
+                Image image{device, extent, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, usage, VK_IMAGE_ASPECT_COLOR_BIT,
+                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+            }));
+            ResourcePool pool{device, 0};
+            results.push_back(measure("resource_pool_image_hit", iterations, 0, [&]() {
+                pool.release(pool.acquireImage(extent, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, usage, VK_IMAGE_ASPECT_COLOR_BIT,
+                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+            }));
+        }
+
+        // Pipelines, uncached then through the factory's deduplication
+        BenchVertexFormat vertexFormat;
+        uint32_t variant = 0;
+        results.push_back(measure("pipeline_create_uncached", iterations, 0, [&]() {
+            BenchPipelineSpec spec{static_cast<float>(variant++)};
+            PipelineInfo info = PipelineFactory::createGraphicPipeline(device, vertexFormat, spec, renderPass);
+            vkDestroyPipeline(device.logical, info.pipeline, nullptr);
+            vkDestroyPipelineLayout(device.logical, info.layout, nullptr);
+        }));
+
+        PipelineFactory pipelineFactory{device};
+        BenchPipelineSpec sharedSpec;
+        PipelineInfo sharedPipeline = pipelineFactory.generateNewPipeline(vertexFormat, sharedSpec, renderPass);
+        results.push_back(measure("pipeline_factory_dedup_hit", iterations, 0, [&]() {
+            PipelineInfo info = pipelineFactory.generateNewPipeline(vertexFormat, sharedSpec, renderPass);
+            pipelineFactory.destroyPipeline(info.pipeline);
+        }));
+        pipelineFactory.destroyPipeline(sharedPipeline.pipeline);
+
+        // A resize with a dynamic viewport and scissor finds the pipeline of the previous size
+        BenchPipelineSpec dynamicSpec{0.f, 256, true};
+        PipelineInfo dynamicPipeline = pipelineFactory.generateNewPipeline(vertexFormat, dynamicSpec, renderPass);
+        uint32_t size = 256;
+        results.push_back(measure("pipeline_factory_resize_hit", iterations, 0, [&]() {
+            BenchPipelineSpec resizedSpec{0.f, ++size, true};
+            PipelineInfo info = pipelineFactory.generateNewPipeline(vertexFormat, resizedSpec, renderPass);
+            pipelineFactory.destroyPipeline(info.pipeline);
+        }));
+        pipelineFactory.destroyPipeline(dynamicPipeline.pipeline);
+
+        return results;
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: " << argv[0] << " [--device <name substring>] [--iterations <count>] [--output <file>]" << std::endl;
+        return 1;
+    }
+
+    HeadlessContext context;
+    VkResult ret;
+    if ((ret = context.create(options.deviceName)) != VK_SUCCESS) {
+        std::cerr << "failed to create a headless Vulkan device: error code " << ret << std::endl;
+        return 1;
+    }
+
+    // Benchmark shaders are served from an archive, as an application would ship them
+    std::string archiveFile = (std::filesystem::temp_directory_path() / "hlvulkan_bench_shaders.hlsa").string();
+    ShaderArchiveBuilder builder;
+    builder.add(VERTEX_SHADER_NAME, std::vector<char>(reinterpret_cast<const char *>(VERTEX_SPIRV.data()),
+                                                      reinterpret_cast<const char *>(VERTEX_SPIRV.data() + VERTEX_SPIRV.size())));
+    builder.add(FRAGMENT_SHADER_NAME, std::vector<char>(reinterpret_cast<const char *>(FRAGMENT_SPIRV.data()),
+                                                        reinterpret_cast<const char *>(FRAGMENT_SPIRV.data() + FRAGMENT_SPIRV.size())));
+    std::shared_ptr<const ShaderArchive> archive;
+    if (!builder.write(archiveFile) || !(archive = ShaderArchive::open(archiveFile))) {
+        std::cerr << "failed to write the benchmark shader archive to " << archiveFile << std::endl;
+        return 1;
+    }
+
+    std::string json;
+    {
+        // Everything created through the library must be gone before the device is destroyed
+        Device device{context.physical, context.logical, context.apiVersion};
+        device.getShaderLibrary().mountArchive(archive);
+        std::vector<BenchResult> results = runBenchmarks(device, Queue{context.queue, context.queueFamily}, options.iterations);
+        json = toJson(device.getCapabilities().getProperties(), results);
+        device.destroy();
+    }
+    archive.reset();
+    std::remove(archiveFile.c_str());
+
+    if (options.output.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream file(options.output);
+        file << json;
+        if (!file) {
+            std::cerr << "failed to write " << options.output << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
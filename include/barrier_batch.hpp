@@ -0,0 +1,75 @@
+#ifndef __HL_VULKAN_BARRIER_BATCH_HPP__
+#define __HL_VULKAN_BARRIER_BATCH_HPP__
+
+#include <map>
+#include <tuple>
+
+#include "buffer.hpp"
+#include "hl_vulkan.hpp"
+#include "image.hpp"
+#include "resource_state.hpp"
+
+namespace HLVulkan {
+
+    // Collects buffer and image transitions and records them as a single vkCmdPipelineBarrier. The previous state of each resource comes from
+    // the resource itself (per subresource for images), transitions that don't need a barrier are dropped and the stage masks are the union of
+    // what the remaining ones need. Transitioning a resource twice before record() keeps the latest access.
+    class BarrierBatch {
+
+      public:
+        void transition(Buffer &buffer, const ResourceAccess &access);
+
+        // The whole image by default
+        void transition(Image &image, const ResourceAccess &access, uint32_t baseMipLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS,
+                        uint32_t baseArrayLayer = 0, uint32_t layerCount = VK_REMAINING_ARRAY_LAYERS);
+
+        // Queue family ownership transfer of an EXCLUSIVE resource: release() is recorded on a queue of srcFamily, then acquire(), with the same
+        // families and access, on a queue of dstFamily in a submission that waits (on a semaphore) for the release. The access is how dstFamily
+        // uses the resource next. The source scope of the release is the resource's tracked state, so writes recorded outside of BarrierBatch
+        // and the copy helpers aren't made available. Concurrent resources and identical families need no transfer, release() does nothing and
+        // acquire() is a plain transition.
+        void release(Buffer &buffer, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access);
+        void acquire(Buffer &buffer, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access);
+
+        // The whole image
+        void release(Image &image, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access);
+        void acquire(Image &image, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access);
+
+        bool empty() const;
+
+        // Records the pending barriers, if any, and clears the batch
+        void record(VkCommandBuffer commandBuffer);
+
+      private:
+        enum class Ownership { KEEP, RELEASE, ACQUIRE };
+
+        struct PendingBarrier {
+            ResourceState previous; // State before the first transition in this batch
+            ResourceAccess access;
+            VkPipelineStageFlags srcStages;
+            VkAccessFlags srcAccess;
+            VkImageLayout oldLayout;
+            bool needed;
+            Ownership ownership;
+            uint32_t srcFamily;
+            uint32_t dstFamily;
+        };
+
+        // Images are keyed by (handle, mip level, array layer) so that their barriers come out sorted by subresource, ready to be merged
+        std::map<VkBuffer, PendingBarrier> bufferBarriers;
+        std::map<std::tuple<VkImage, uint32_t, uint32_t>, PendingBarrier> imageBarriers;
+        std::map<VkImage, VkImageAspectFlags> imageAspects;
+
+        static void update(PendingBarrier &pending, ResourceState &state, const ResourceAccess &access, bool trackLayout, bool first);
+        static void updateOwnership(PendingBarrier &pending, ResourceState &state, const ResourceAccess &access, bool trackLayout, bool first,
+                                    Ownership ownership, uint32_t srcFamily, uint32_t dstFamily);
+        static VkPipelineStageFlags getDstStages(const PendingBarrier &pending);
+        static VkAccessFlags getDstAccess(const PendingBarrier &pending);
+
+        void transferOwnership(Buffer &buffer, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access, Ownership ownership);
+        void transferOwnership(Image &image, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access, Ownership ownership);
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_BARRIER_BATCH_HPP__
@@ -4,6 +4,7 @@
 #include "command_pool.hpp"
 #include "device.hpp"
 #include "hl_vulkan.hpp"
+#include "resource_state.hpp"
 
 namespace HLVulkan {
 
@@ -14,26 +15,53 @@ namespace HLVulkan {
         VkDeviceSize size;
         VkBufferUsageFlags usage;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        MemoryAllocation allocation;
         VkMemoryPropertyFlags memProperties = 0;
+        bool persistentMap = false;
+        void *mapped = nullptr;
+        std::vector<uint32_t> queueFamilies;
+
+        ResourceState state;
+        friend class BarrierBatch;
+        friend class Image;
 
         VkResult bind();
 
       public:
-        static VkResult createBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer);
+        // CONCURRENT sharing between the queue families if there are more than one, no ownership transfer needed then (see
+        // BarrierBatch::release()). For buffers this usually costs nothing, unlike images.
+        static VkResult createBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer,
+                                     const std::vector<uint32_t> &queueFamilies = {});
 
-        Buffer(Device device, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+        Buffer(Device device, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const std::vector<uint32_t> &queueFamilies = {});
 
-        Buffer(Device device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+        // With persistentMap set, HOST_VISIBLE memory stays mapped from bind() until destruction
+        Buffer(Device device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool persistentMap = false,
+               const std::vector<uint32_t> &queueFamilies = {});
 
         VkResult allocateBuffer(VkDeviceSize size);
 
-        VkResult mapAndCopy(const void *dataToCopy, size_t size);
+        VkResult mapAndCopy(const void *dataToCopy, size_t size, VkDeviceSize offset = 0);
+
+        // Makes host writes to a persistently mapped buffer visible to the device. Only needed for non-coherent memory.
+        VkResult flush(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+        // Blocking: submits and waits for the copy. Use TransferEngine to batch copies instead.
+        VkResult copyTo(Buffer &dstBuffer, CommandPool &commandPool);
 
-        VkResult copyTo(const Buffer &dstBuffer, CommandPool &commandPool);
+        // Both buffers must already be transitioned for the copy, which is then recorded in their tracked state (a transfer read of this
+        // buffer, a transfer write of dstBuffer)
+        void recordCopyTo(VkCommandBuffer commandBuffer, Buffer &dstBuffer);
 
         VkBufferUsageFlags getUsageFlags();
         VkBuffer getBuffer();
+        VkDeviceSize getSize() const;
+        bool isConcurrent() const;
+        VkMemoryPropertyFlags getMemoryProperties() const;
+        bool isPersistentlyMapped() const;
+        void *getMappedData() const;
+        bool isCoherent() const;
+        const MemoryAllocation &getAllocation() const;
 
         ~Buffer();
     };
@@ -1,39 +1,81 @@
 #ifndef __HL_VULKAN_COMMAND_POOL_HPP__
 #define __HL_VULKAN_COMMAND_POOL_HPP__
 
+#include <unordered_map>
+
 #include "device.hpp"
 #include "hl_vulkan.hpp"
 #include "queue.hpp"
 
 namespace HLVulkan {
 
+    class GpuProfiler;
+
+    // Command buffers handed out by acquireCommandBuffer() are recycled rather than freed: release() puts one back on the free list and reset()
+    // resets the whole pool at once (typically once per frame, when the GPU is done with it) and puts back every acquired one. Allocation only
+    // happens when the free list runs dry, so a steady state doesn't allocate. Not thread safe.
     class CommandPool {
 
       public:
-        CommandPool(Device device, Queue queue);
+        static const VkCommandPoolCreateFlags DEFAULT_FLAGS = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+        // Preallocates count command buffers, see getCommandBuffer()
+        CommandPool(Device device, Queue queue, uint32_t count = 0, VkCommandPoolCreateFlags flags = DEFAULT_FLAGS);
 
-        CommandPool(Device device, Queue queue, uint32_t count);
+        CommandPool(const CommandPool &) = delete;
+        CommandPool &operator=(const CommandPool &) = delete;
 
+        // Appends count command buffers to the ones returned by getCommandBuffer()
         VkResult allocateCommandBuffers(uint32_t count);
 
-        VkCommandBuffer beginSingleTimeCommands();
+        // A command buffer in the initial state, recycled when possible
+        VkCommandBuffer acquireCommandBuffer(VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+        // Back to the free list, the command buffer must not be pending anymore. Freed instead if the pool lacks RESET_COMMAND_BUFFER.
+        void release(VkCommandBuffer commandBuffer);
+
+        // Resets every command buffer of the pool, none may be pending. Acquired ones go back to the free list.
+        VkResult reset(VkCommandPoolResetFlags flags = 0);
+
+        // With a profiler set, a labelled command buffer is measured as a zone of the same name
+        VkCommandBuffer beginSingleTimeCommands(const char *label = nullptr);
 
         VkResult endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
+        // Gives up on a command buffer from beginSingleTimeCommands() whose recording failed, without submitting it
+        void abortSingleTimeCommands(VkCommandBuffer commandBuffer);
+
         VkCommandBuffer getCommandBuffer(size_t index);
 
         VkCommandPool getPool();
 
+        // Number of vkAllocateCommandBuffers() calls so far
+        size_t getAllocationCount() const;
+
+        // The queue family must support timestamps (non-zero timestampValidBits). nullptr disables profiling.
+        void setProfiler(GpuProfiler *profiler);
+        GpuProfiler *getProfiler() const;
+
         virtual ~CommandPool();
 
       private:
         const Device device;
         const Queue queue;
+        const VkCommandPoolCreateFlags flags;
 
         VkCommandPool pool = VK_NULL_HANDLE;
         std::vector<VkCommandBuffer> commandBuffers;
+
+        // Indexed by VkCommandBufferLevel
+        static const size_t LEVEL_COUNT = 2;
+        std::vector<VkCommandBuffer> freeCommandBuffers[LEVEL_COUNT];
+        std::vector<VkCommandBuffer> acquiredCommandBuffers[LEVEL_COUNT];
+        size_t allocationCount = 0;
+
+        GpuProfiler *profiler = nullptr;
+        std::unordered_map<VkCommandBuffer, uint32_t> zones;
     };
 
 } // namespace HLVulkan
 
-#endif //__HL_VULKAN_COMMAND_POOL_HPP__
\ No newline at end of file
+#endif //__HL_VULKAN_COMMAND_POOL_HPP__
@@ -0,0 +1,83 @@
+#ifndef __HL_VULKAN_DESCRIPTOR_ALLOCATOR_HPP__
+#define __HL_VULKAN_DESCRIPTOR_ALLOCATOR_HPP__
+
+#include <deque>
+
+#include "device.hpp"
+#include "hl_vulkan.hpp"
+
+namespace HLVulkan {
+
+    // Descriptors of a type reserved in each pool, per set the pool can hold
+    struct DescriptorPoolRatio {
+        VkDescriptorType type;
+        float perSet;
+    };
+
+    // Hands out descriptor sets from a chain of pools. When a pool runs out, allocation moves on to a recycled pool or a new one, each new pool
+    // twice as big as the previous one (up to MAX_SETS_PER_POOL). Sets are never freed individually: reset() recycles every pool at once,
+    // typically once per frame when the GPU is done with that frame's sets (one allocator per frame in flight), so a steady state doesn't create
+    // pools. Not thread safe.
+    class DescriptorAllocator {
+
+      public:
+        static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+        static const std::vector<DescriptorPoolRatio> DEFAULT_RATIOS;
+
+        DescriptorAllocator(Device device, uint32_t setsPerPool = 64, const std::vector<DescriptorPoolRatio> &ratios = DEFAULT_RATIOS);
+
+        DescriptorAllocator(const DescriptorAllocator &) = delete;
+        DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+        VkResult allocate(VkDescriptorSetLayout layout, VkDescriptorSet &set);
+
+        // With the layout of the bindings from the device's layout cache
+        VkResult allocate(const std::vector<VkDescriptorSetLayoutBinding> &bindings, VkDescriptorSet &set);
+
+        // Every set allocated so far becomes invalid, none may still be in use by the GPU
+        VkResult reset();
+
+        // Number of vkCreateDescriptorPool() calls so far
+        size_t getPoolCount() const;
+
+        ~DescriptorAllocator();
+
+      private:
+        const Device device;
+        const std::vector<DescriptorPoolRatio> ratios;
+        uint32_t setsPerPool;
+
+        VkDescriptorPool currentPool = VK_NULL_HANDLE;
+        std::vector<VkDescriptorPool> fullPools;
+        std::vector<VkDescriptorPool> freePools;
+        size_t poolCount = 0;
+
+        VkResult nextPool();
+    };
+
+    // Gathers descriptor writes, to any number of sets, and applies them with a single vkUpdateDescriptorSets(). Not thread safe.
+    class DescriptorWriter {
+
+      public:
+        DescriptorWriter &writeBuffer(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0,
+                                      VkDeviceSize range = VK_WHOLE_SIZE, uint32_t arrayElement = 0);
+
+        DescriptorWriter &writeImage(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler = VK_NULL_HANDLE,
+                                     VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, uint32_t arrayElement = 0);
+
+        bool empty() const;
+
+        // Applies the pending writes and clears them
+        void update(VkDevice device);
+
+      private:
+        std::vector<VkWriteDescriptorSet> writes;
+
+        // Deques keep the addresses the writes point to stable
+        std::deque<VkDescriptorBufferInfo> bufferInfos;
+        std::deque<VkDescriptorImageInfo> imageInfos;
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_DESCRIPTOR_ALLOCATOR_HPP__
@@ -0,0 +1,43 @@
+#ifndef __HL_VULKAN_DESCRIPTOR_LAYOUT_CACHE_HPP__
+#define __HL_VULKAN_DESCRIPTOR_LAYOUT_CACHE_HPP__
+
+#include <mutex>
+#include <unordered_map>
+
+#include "hl_vulkan.hpp"
+#include "state_key.hpp"
+
+namespace HLVulkan {
+
+    // Creates one descriptor set layout per unique set of bindings (binding order doesn't matter) and hands out the same handle to every
+    // identical request, so that pipelines and descriptor sets built from the same description share layouts. The layouts belong to the cache
+    // and live as long as it does. Thread safe.
+    class DescriptorSetLayoutCache {
+
+      public:
+        explicit DescriptorSetLayoutCache(VkDevice device);
+
+        DescriptorSetLayoutCache(const DescriptorSetLayoutCache &) = delete;
+        DescriptorSetLayoutCache &operator=(const DescriptorSetLayoutCache &) = delete;
+
+        // VK_NULL_HANDLE if the layout can't be created
+        VkDescriptorSetLayout getLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings, VkDescriptorSetLayoutCreateFlags flags = 0);
+
+        // Number of layouts created so far
+        size_t size() const;
+
+        // Destroys every layout, none may still be used
+        void clear();
+
+        ~DescriptorSetLayoutCache();
+
+      private:
+        const VkDevice device;
+
+        mutable std::mutex mutex;
+        std::unordered_map<StateKey, VkDescriptorSetLayout, StateKeyHasher> layouts;
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_DESCRIPTOR_LAYOUT_CACHE_HPP__
@@ -1,22 +1,60 @@
 #ifndef __HL_VULKAN_DEVICE_HPP__
 #define __HL_VULKAN_DEVICE_HPP__
 
+#include <memory>
+
+#include "descriptor_layout_cache.hpp"
+#include "device_capabilities.hpp"
+#include "framebuffer_cache.hpp"
 #include "hl_vulkan.hpp"
+#include "memory_allocator.hpp"
+#include "render_pass_registry.hpp"
+#include "shader_library.hpp"
 
 namespace HLVulkan {
 
+    // Handles of a device plus the state shared by every copy of it: capabilities, memory allocator and the shader, layout, framebuffer and
+    // render pass caches. A Device constructed separately for the same VkDevice has its own. The allocator and caches hold Vulkan objects, so
+    // destroy() must be called before vkDestroyDevice().
     struct Device {
         const VkPhysicalDevice physical;
         const VkDevice logical;
 
-        Device(VkPhysicalDevice physicalDevice, VkDevice device);
+        // See DeviceCapabilities for the instance version. The enabled extensions are the ppEnabledExtensionNames the device was created with,
+        // the library only relies on optional extensions listed there.
+        Device(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t instanceApiVersion = VK_API_VERSION_1_0,
+               const std::vector<const char *> &enabledExtensions = {});
         Device(const Device &device);
 
-        std::optional<uint32_t> findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        // Best memory type having the properties, see DeviceCapabilities::getMemoryTypes()
+        std::optional<uint32_t> findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferred = 0) const;
 
         VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features) const;
 
         VkFormat findDepthFormat() const;
+
+        bool isExtensionEnabled(const char *name) const;
+
+        // Shared by every copy of this device
+        const DeviceCapabilities &getCapabilities() const;
+        MemoryAllocator &getAllocator() const;
+        ShaderLibrary &getShaderLibrary() const;
+        DescriptorSetLayoutCache &getDescriptorLayoutCache() const;
+        FramebufferCache &getFramebufferCache() const;
+        RenderPassRegistry &getRenderPassRegistry() const;
+
+        // Frees the framebuffers, descriptor set layouts, shader modules and memory blocks held for every copy of the device. The GPU must be
+        // idle and every object created from the device destroyed. Call it right before vkDestroyDevice().
+        void destroy();
+
+      private:
+        std::shared_ptr<const DeviceCapabilities> capabilities;
+        std::shared_ptr<MemoryAllocator> allocator;
+        std::shared_ptr<ShaderLibrary> shaderLibrary;
+        std::shared_ptr<DescriptorSetLayoutCache> descriptorLayoutCache;
+        std::shared_ptr<FramebufferCache> framebufferCache;
+        std::shared_ptr<RenderPassRegistry> renderPassRegistry;
+        std::shared_ptr<const std::vector<std::string>> enabledExtensions;
     };
 
 } // namespace HLVulkan
@@ -0,0 +1,95 @@
+#ifndef __HL_VULKAN_DEVICE_CAPABILITIES_HPP__
+#define __HL_VULKAN_DEVICE_CAPABILITIES_HPP__
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+
+#include "hl_vulkan.hpp"
+
+namespace HLVulkan {
+
+    // One-time snapshot of the physical device properties needed on the resource creation path, so that memory type and format lookups never
+    // go back to the driver. Core formats are queried up front, extension formats the first time they're asked for. Thread safe.
+    class DeviceCapabilities {
+
+      public:
+        // instanceApiVersion is the VkApplicationInfo::apiVersion the instance was created with, features of later versions aren't queried
+        explicit DeviceCapabilities(VkPhysicalDevice physical, uint32_t instanceApiVersion = VK_API_VERSION_1_0);
+
+        DeviceCapabilities(const DeviceCapabilities &) = delete;
+        DeviceCapabilities &operator=(const DeviceCapabilities &) = delete;
+
+        const VkPhysicalDeviceProperties &getProperties() const;
+
+        // Supported core features, the ones the library relies on still have to be enabled when creating the logical device
+        const VkPhysicalDeviceFeatures &getFeatures() const;
+        const VkPhysicalDeviceMemoryProperties &getMemoryProperties() const;
+
+        // Memory types in typeBits having every required flag, best first: most preferred flags, then fewest flags nobody asked for (so that
+        // e.g. host cached or device local host visible memory isn't used up by requests that don't need it), then biggest heap
+        const std::vector<uint32_t> &getMemoryTypes(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) const;
+
+        std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) const;
+
+        VkFormatProperties getFormatProperties(VkFormat format) const;
+
+        bool supportsFormat(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features) const;
+
+        const std::vector<VkQueueFamilyProperties> &getQueueFamilies() const;
+
+        // First family having every required flag and none of the excluded ones
+        std::optional<uint32_t> findQueueFamily(VkQueueFlags required, VkQueueFlags excluded = 0) const;
+
+        // Family of dedicated transfer queues (copy engines): transfer but neither graphics nor compute. Image copies on it must be aligned on
+        // the family's minImageTransferGranularity.
+        std::optional<uint32_t> findTransferQueueFamily() const;
+
+        // VK_EXT_extended_dynamic_state and its feature are available, they still have to be enabled when creating the logical device
+        bool supportsExtendedDynamicState() const;
+
+        // Vulkan 1.2 with the hostQueryReset feature, which must also be enabled on the logical device
+        bool supportsHostQueryReset() const;
+
+        // Vulkan 1.2 with the timelineSemaphore feature, which must also be enabled on the logical device
+        bool supportsTimelineSemaphores() const;
+
+      private:
+        struct MemoryTypeQuery {
+            uint32_t typeBits;
+            VkMemoryPropertyFlags required;
+            VkMemoryPropertyFlags preferred;
+
+            bool operator==(const MemoryTypeQuery &other) const {
+                return typeBits == other.typeBits && required == other.required && preferred == other.preferred;
+            }
+        };
+        struct MemoryTypeQueryHasher {
+            size_t operator()(const MemoryTypeQuery &query) const {
+                return std::hash<uint64_t>{}((static_cast<uint64_t>(query.typeBits) << 32 | query.required) ^ (static_cast<uint64_t>(query.preferred) << 17));
+            }
+        };
+
+        static constexpr uint32_t CORE_FORMAT_COUNT = VK_FORMAT_ASTC_12x12_SRGB_BLOCK + 1;
+
+        const VkPhysicalDevice physical;
+        VkPhysicalDeviceProperties properties;
+        VkPhysicalDeviceFeatures features;
+        VkPhysicalDeviceMemoryProperties memProperties;
+        std::array<VkFormatProperties, CORE_FORMAT_COUNT> coreFormats;
+        std::vector<VkQueueFamilyProperties> queueFamilies;
+        bool extendedDynamicState = false;
+        bool hostQueryReset = false;
+        bool timelineSemaphores = false;
+
+        mutable std::mutex mutex;
+        mutable std::unordered_map<MemoryTypeQuery, std::vector<uint32_t>, MemoryTypeQueryHasher> memoryTypes;
+        mutable std::unordered_map<VkFormat, VkFormatProperties> extensionFormats;
+
+        std::vector<uint32_t> rankMemoryTypes(const MemoryTypeQuery &query) const;
+        bool hasExtension(const char *name) const;
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_DEVICE_CAPABILITIES_HPP__
@@ -12,13 +12,23 @@ namespace HLVulkan {
         VkFence fence = VK_NULL_HANDLE;
 
       public:
-        Fence(Device device);
+        Fence(Device device, bool signaled = true);
+
+        Fence(const Fence &) = delete;
+        Fence &operator=(const Fence &) = delete;
 
         const VkFence getFence();
 
+        // VK_TIMEOUT if the fence wasn't signaled in time
+        VkResult wait(uint64_t timeout = UINT64_MAX) const;
+
+        VkResult reset();
+
+        bool isSignaled() const;
+
         ~Fence();
     };
 
 } // namespace HLVulkan
 
-#endif //__HL_VULKAN_FENCE_HPP__
\ No newline at end of file
+#endif //__HL_VULKAN_FENCE_HPP__
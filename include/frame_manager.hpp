@@ -0,0 +1,87 @@
+#ifndef __HL_VULKAN_FRAME_MANAGER_HPP__
+#define __HL_VULKAN_FRAME_MANAGER_HPP__
+
+#include <functional>
+#include <memory>
+
+#include "command_pool.hpp"
+#include "device.hpp"
+#include "fence.hpp"
+#include "hl_vulkan.hpp"
+#include "queue.hpp"
+#include "ring_buffer.hpp"
+
+namespace HLVulkan {
+
+    // Ring of framesInFlight frame contexts, each with its fence, command pool and deferred releases, so that the CPU records a frame while
+    // the GPU still executes the previous ones. beginFrame() waits for the frame that last used the context (framesInFlight frames ago) and
+    // recycles it, endFrame() submits the frame's command buffer with its fence. The optional ring buffer hands out per frame slices and is
+    // advanced in lockstep. Not thread safe.
+    class FrameManager {
+
+      public:
+        // No ring buffer if ringSize is 0
+        FrameManager(Device device, Queue queue, uint32_t framesInFlight = 2, VkDeviceSize ringSize = 0,
+                     VkBufferUsageFlags ringUsage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+        FrameManager(const FrameManager &) = delete;
+        FrameManager &operator=(const FrameManager &) = delete;
+
+        // Waits for the oldest frame, runs its deferred releases and begins the primary command buffer of the new one
+        VkResult beginFrame(uint64_t timeout = UINT64_MAX);
+
+        // Ends the command buffer and submits it, signaling the frame's fence
+        VkResult endFrame(const std::vector<VkSemaphore> &waitSemaphores = {}, const std::vector<VkPipelineStageFlags> &waitStages = {},
+                          const std::vector<VkSemaphore> &signalSemaphores = {});
+
+        // Runs once the GPU is done with the current frame (destroying a resource it used, typically)
+        void deferRelease(std::function<void()> release);
+
+        // Keeps the object alive until the GPU is done with the current frame
+        void keepAlive(std::shared_ptr<void> resource);
+
+        VkCommandBuffer getCommandBuffer() const;
+
+        // Pool of the current frame, reset when the frame context is recycled
+        CommandPool &getCommandPool();
+
+        // Slice of the ring buffer, valid until the GPU is done with the current frame
+        std::optional<RingAllocation> allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+
+        // Index of the current frame context, in [0, framesInFlight)
+        uint32_t getFrameIndex() const;
+
+        // Frames begun so far
+        uint64_t getFrameCount() const;
+
+        uint32_t getFramesInFlight() const;
+
+        // Waits for every submitted frame and runs all the deferred releases
+        VkResult waitIdle();
+
+        ~FrameManager();
+
+      private:
+        struct FrameContext {
+            std::unique_ptr<Fence> fence;
+            std::unique_ptr<CommandPool> commandPool;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            std::vector<std::function<void()>> releases;
+            bool submitted = false;
+        };
+
+        const Device device;
+        const Queue queue;
+
+        std::vector<FrameContext> frames;
+        std::unique_ptr<RingBuffer> ringBuffer;
+        uint64_t frameCount = 0;
+        bool recording = false;
+
+        FrameContext &current();
+        static void runReleases(FrameContext &frame);
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_FRAME_MANAGER_HPP__
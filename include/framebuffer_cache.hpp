@@ -0,0 +1,64 @@
+#ifndef __HL_VULKAN_FRAMEBUFFER_CACHE_HPP__
+#define __HL_VULKAN_FRAMEBUFFER_CACHE_HPP__
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "hl_vulkan.hpp"
+#include "state_key.hpp"
+
+namespace HLVulkan {
+
+    class Image;
+    class RenderPassSpec;
+
+    // Creates one framebuffer per (render pass, attachment views, extent, layers) and hands out the same handle to every identical request, so
+    // that rendering to the same targets every frame doesn't create framebuffers. Entries are evicted with the views or render pass they use:
+    // Image does it for its own view, owners of other views (swapchain images) call evictView() before destroying them. Thread safe.
+    class FramebufferCache {
+
+      public:
+        explicit FramebufferCache(VkDevice device);
+
+        FramebufferCache(const FramebufferCache &) = delete;
+        FramebufferCache &operator=(const FramebufferCache &) = delete;
+
+        // VK_NULL_HANDLE if the framebuffer can't be created
+        VkFramebuffer getFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView> &attachments, VkExtent2D extent, uint32_t layers = 1);
+
+        // Framebuffer of the images' views for a render pass created from the spec, VK_NULL_HANDLE (and an assert in debug builds) if a
+        // transient image backs an attachment that is loaded or stored (see RenderPassSpec::checkTransientAttachments())
+        VkFramebuffer getFramebuffer(VkRenderPass renderPass, const RenderPassSpec &spec, const std::vector<const Image *> &images, VkExtent2D extent,
+                                     uint32_t layers = 1);
+
+        // Destroy the framebuffers using the view or render pass, none may still be in use by the GPU
+        void evictView(VkImageView view);
+        void evictRenderPass(VkRenderPass renderPass);
+
+        // Number of live framebuffers
+        size_t size() const;
+
+        // Destroys every framebuffer, none may still be in use by the GPU
+        void clear();
+
+        ~FramebufferCache();
+
+      private:
+        struct Entry {
+            VkFramebuffer framebuffer;
+            VkRenderPass renderPass;
+            std::vector<VkImageView> attachments;
+        };
+
+        const VkDevice device;
+
+        mutable std::mutex mutex;
+        std::unordered_map<StateKey, Entry, StateKeyHasher> framebuffers;
+
+        template <class Predicate> void evict(Predicate predicate);
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_FRAMEBUFFER_CACHE_HPP__
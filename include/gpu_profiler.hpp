@@ -0,0 +1,101 @@
+#ifndef __HL_VULKAN_GPU_PROFILER_HPP__
+#define __HL_VULKAN_GPU_PROFILER_HPP__
+
+#include <mutex>
+#include <string>
+
+#include "device.hpp"
+#include "hl_vulkan.hpp"
+
+namespace HLVulkan {
+
+    struct GpuZone {
+        std::string name;
+        uint64_t frame;
+        uint64_t startNs; // In the device timestamp domain
+        uint64_t durationNs;
+    };
+
+    // Measures GPU time of command buffer ranges (zones) with timestamp queries. Each frame in flight has its own query pool, read back when the
+    // frame comes around again, by which time its GPU work is complete, so reading never stalls. The pools are reset from the host, which needs
+    // Vulkan 1.2 with the hostQueryReset feature enabled (see DeviceCapabilities::supportsHostQueryReset()). Zones past maxZonesPerFrame in a
+    // frame are dropped. Thread safe, as long as each command buffer is recorded by a single thread.
+    class GpuProfiler {
+
+      public:
+        static const uint32_t INVALID_ZONE = UINT32_MAX;
+
+        // The profiled command buffers are submitted to queues of queueFamily, which must support timestamps
+        GpuProfiler(Device device, uint32_t queueFamily, uint32_t framesInFlight = 2, uint32_t maxZonesPerFrame = 256);
+
+        GpuProfiler(const GpuProfiler &) = delete;
+        GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+        // Collects the zones of the frame that last used the oldest pool and reuses it. Its GPU work must be complete, and every frame before
+        // the new one must have been submitted.
+        void beginFrame();
+
+        // Zones must be ended in the frame they began in
+        uint32_t beginZone(VkCommandBuffer commandBuffer, const std::string &name);
+        void endZone(VkCommandBuffer commandBuffer, uint32_t zone);
+
+        // Collects every zone still in the pools, waiting for the GPU to finish the earlier frames. The current frame may not have been
+        // submitted yet, its zones are only collected if they're all available already.
+        void collectAll();
+
+        // Collected zones, oldest first
+        std::vector<GpuZone> getZones() const;
+        void clearZones();
+
+        size_t getDroppedCount() const;
+
+        // Chrome trace event format, loads in chrome://tracing and Perfetto
+        bool writeChromeTrace(const std::string &filename) const;
+
+        ~GpuProfiler();
+
+      private:
+        struct FrameQueries {
+            VkQueryPool pool = VK_NULL_HANDLE;
+            uint64_t frame = 0;
+            std::vector<std::string> names;
+            std::vector<bool> ended;
+        };
+
+        const Device device;
+        const uint32_t maxZonesPerFrame;
+        const double timestampPeriod;
+        const uint64_t timestampMask; // Bits of a timestamp the queue family writes, the others are undefined
+
+        mutable std::mutex mutex;
+        std::vector<FrameQueries> frames;
+        uint64_t frameCount = 0;
+        std::vector<GpuZone> zones;
+        size_t droppedCount = 0;
+
+        FrameQueries &current();
+        bool isAvailable(const FrameQueries &queries) const;
+        // Waiting is only safe for submitted frames, and only for the zones that were ended
+        void collect(FrameQueries &queries, bool wait);
+    };
+
+    // Zone covering the commands recorded during its lifetime. No-op without a profiler.
+    class ScopedZone {
+
+      public:
+        ScopedZone(GpuProfiler *profiler, VkCommandBuffer commandBuffer, const std::string &name);
+
+        ScopedZone(const ScopedZone &) = delete;
+        ScopedZone &operator=(const ScopedZone &) = delete;
+
+        ~ScopedZone();
+
+      private:
+        GpuProfiler *profiler;
+        VkCommandBuffer commandBuffer;
+        uint32_t zone = GpuProfiler::INVALID_ZONE;
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_GPU_PROFILER_HPP__
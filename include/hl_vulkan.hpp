@@ -64,6 +64,15 @@ namespace HLVulkan {
 
     bool hasStencilComponent(VkFormat format);
 
+    bool hasDepthComponent(VkFormat format);
+
+    // Sorted and without duplicates, as required for CONCURRENT sharing
+    std::vector<uint32_t> getDistinctQueueFamilies(const std::vector<uint32_t> &queueFamilies);
+
+    // Writes to a temporary file next to the destination, syncs it and renames it over the destination, so that readers never see a partially
+    // written file, even after a crash. Returns false and leaves the destination untouched on failure.
+    bool writeFileAtomically(const std::string &filename, const char *data, size_t size);
+
 } // namespace HLVulkan
 
 #endif //__HL_VULKAN_HPP__
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "command_pool.hpp"
 #include "device.hpp"
 #include "hl_vulkan.hpp"
+#include "resource_state.hpp"
 
 namespace HLVulkan {
 
@@ -19,29 +20,106 @@ namespace HLVulkan {
         VkImageAspectFlags aspect;
 
         VkImage image = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        MemoryAllocation allocation;
         VkImageView imageView = VK_NULL_HANDLE;
         VkMemoryPropertyFlags memProperties = 0;
+        std::vector<uint32_t> queueFamilies;
+
+        // Tracked state of each subresource, indexed by mipLevel * arrayLayers + arrayLayer
+        uint32_t mipLevels = 1;
+        uint32_t arrayLayers = 1;
+        std::vector<ResourceState> subresourceStates;
+
+        friend class BarrierBatch;
+
+        ResourceState &getSubresourceState(uint32_t mipLevel, uint32_t arrayLayer);
+        void recordAccess(const ResourceAccess &access, uint32_t levelCount);
+        VkImageAspectFlags getBarrierAspect() const;
 
       public:
-        static VkResult createImage(VkDevice device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImage &image);
+        // CONCURRENT sharing between the queue families if there are more than one. It may disable compression of attachments on some
+        // hardware, so images written on one queue and read on another are usually better off EXCLUSIVE with ownership transfers.
+        static VkResult createImage(VkDevice device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImage &image,
+                                    uint32_t mipLevels = 1, const std::vector<uint32_t> &queueFamilies = {});
+
+        // The view covers mip levels [baseMipLevel, baseMipLevel + levelCount)
+        static VkResult createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect, VkImageView &imageView,
+                                        uint32_t baseMipLevel = 0, uint32_t levelCount = 1);
 
-        static VkResult createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect, VkImageView &imageView);
+        // Number of levels of a full mip chain, down to 1x1
+        static uint32_t getMipLevelCount(VkExtent2D extent);
 
+        // Memory needs of an image created with these parameters, found by creating (and destroying) one
+        static VkResult getMemoryRequirements(VkDevice device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+                                              VkMemoryRequirements &requirements, uint32_t mipLevels = 1);
+
+        // With VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT the image is a transient attachment: its content never leaves the render pass (see
+        // RenderPassSpec::createTransientAttachment()), so it is bound to lazily allocated memory where the device exposes it, and to regular
+        // pooled memory with the given properties otherwise
+        Image(Device device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+              VkMemoryPropertyFlags properties, uint32_t mipLevels = 1, const std::vector<uint32_t> &queueFamilies = {});
+
+        // Bound at offset within memory owned by the caller, e.g. shared by aliased images that are never in use at the same time. The memory must
+        // satisfy getMemoryRequirements() and outlive the image.
         Image(Device device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageAspectFlags aspect,
-              VkMemoryPropertyFlags properties);
+              const MemoryAllocation &memory, VkDeviceSize offset = 0);
 
         VkResult bind(VkMemoryPropertyFlags properties);
 
-        VkResult copyTo(const Image &dstImage, CommandPool &commandPool);
+        // Level 0 of this image in TRANSFER_SRC_OPTIMAL to level 0 of dstImage in TRANSFER_DST_OPTIMAL
+        VkResult copyTo(Image &dstImage, CommandPool &commandPool);
 
+        // Blocking: submits and waits for the copy. Use TransferEngine to batch copies instead.
         VkResult copyFromBuffer(VkImageLayout layout, Buffer &buffer, CommandPool &commandPool);
 
+        // The image must already be in layout and the buffer transitioned for the copy, which is then recorded in their tracked state
+        void recordCopyFromBuffer(VkCommandBuffer commandBuffer, VkImageLayout layout, Buffer &buffer);
+
+        // Precomputed mip levels, tightly packed in the buffer: level i starts at levelOffsets[i]. Every level is copied by a single command.
+        VkResult copyFromBuffer(VkImageLayout layout, Buffer &buffer, const std::vector<VkDeviceSize> &levelOffsets, CommandPool &commandPool);
+        void recordCopyFromBuffer(VkCommandBuffer commandBuffer, VkImageLayout layout, Buffer &buffer, const std::vector<VkDeviceSize> &levelOffsets);
+
+        // Whether generateMipmaps() can be used: linear filtered blits supported by the format, and transfer source and destination usage
+        bool supportsBlitMipmaps() const;
+
+        // Fills levels 1 and up from level 0 with a cascade of linear blits, then leaves every level in SHADER_READ_ONLY_OPTIMAL. See
+        // MipmapGenerator for formats that can't be blitted.
+        VkResult generateMipmaps(CommandPool &commandPool);
+        void recordGenerateMipmaps(VkCommandBuffer commandBuffer);
+
+        // Blocking: submits and waits for the barrier. Use TransferEngine or a BarrierBatch to batch transitions instead.
+        VkResult transitionImageLayout(VkImageLayout newLayout, CommandPool &commandPool);
+
+        // Transitions every subresource from its tracked layout to the usual access of newLayout (see ResourceAccess::forLayout())
+        void recordTransitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout newLayout);
+
+        // Same as above, but the caller asserts the current layout instead of relying on tracking
         VkResult transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout, CommandPool &commandPool);
+        VkResult recordTransitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout);
+
+        // Forgets the content, e.g. after an aliased image used the memory: the next transition starts from UNDEFINED, once the last use of the
+        // memory (writes, or reads alone) by stages has completed
+        void discardContent(VkPipelineStageFlags stages, VkAccessFlags writeAccess);
+
+        VkImageLayout getLayout(uint32_t mipLevel = 0, uint32_t arrayLayer = 0) const;
 
         VkImage getImage() const;
+        VkFormat getFormat() const;
+        VkExtent2D getExtent() const;
+        VkImageTiling getTiling() const;
+        VkImageUsageFlags getUsage() const;
+        VkImageAspectFlags getAspect() const;
+        VkMemoryPropertyFlags getMemoryProperties() const;
+        VkExtent2D getLevelExtent(uint32_t mipLevel) const;
+        uint32_t getMipLevels() const;
+        uint32_t getArrayLayers() const;
+        bool isConcurrent() const;
+        bool isTransient() const;
+        // Whether the memory is only committed as the device needs it, only ever true for transient attachments
+        bool isLazilyAllocated() const;
         VkImageView getView() const;
         VkDeviceMemory getMemory() const;
+        const MemoryAllocation &getAllocation() const;
 
         ~Image();
     };
@@ -0,0 +1,109 @@
+#ifndef __HL_VULKAN_MEMORY_ALLOCATOR_HPP__
+#define __HL_VULKAN_MEMORY_ALLOCATOR_HPP__
+
+#include <memory>
+#include <mutex>
+
+#include "device_capabilities.hpp"
+#include "hl_vulkan.hpp"
+
+namespace HLVulkan {
+
+    struct MemoryBlock;
+
+    struct MemoryAllocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        uint32_t memoryType = 0;
+        MemoryBlock *block = nullptr;
+    };
+
+    struct MemoryStats {
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize reservedBytes = 0;  // Bytes obtained through vkAllocateMemory
+        VkDeviceSize requestedBytes = 0; // Bytes asked for by resources
+        VkDeviceSize allocatedBytes = 0; // Bytes handed out after buddy rounding
+        VkDeviceSize freeBytes = 0;
+        VkDeviceSize largestFreeRange = 0;
+
+        // Share of handed out bytes lost to power-of-two rounding
+        float internalFragmentation() const;
+        // Share of free bytes not usable by a single allocation of the largest free size
+        float externalFragmentation() const;
+    };
+
+    struct MemoryBlockStats {
+        uint32_t memoryType;
+        bool dedicated;
+        VkDeviceSize size;
+        VkDeviceSize allocatedBytes;
+        VkDeviceSize largestFreeRange;
+        uint32_t allocationCount;
+        uint32_t freeRangeCount;
+    };
+
+    // Sub-allocates device memory out of large per-memory-type blocks using a buddy strategy. Requests bigger than half a block get a dedicated
+    // allocation. Linear and optimal resources are kept in separate blocks whenever bufferImageGranularity exceeds the smallest buddy size, so that they
+    // can never share a granularity page.
+    class MemoryAllocator {
+
+      public:
+        enum class ResourceType { LINEAR, OPTIMAL };
+
+        static constexpr VkDeviceSize MIN_ALLOCATION_SIZE = 256;
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+        MemoryAllocator(std::shared_ptr<const DeviceCapabilities> capabilities, VkDevice logical, VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE);
+
+        MemoryAllocator(const MemoryAllocator &) = delete;
+        MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+
+        // Memory types having every required property are tried best first (see DeviceCapabilities::getMemoryTypes()), so that a full heap
+        // falls back to the next suitable one
+        VkResult allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, ResourceType type, MemoryAllocation &allocation,
+                          VkMemoryPropertyFlags preferredProperties = 0);
+
+        void free(MemoryAllocation &allocation);
+
+        VkResult map(const MemoryAllocation &allocation, void **data);
+
+        void unmap(const MemoryAllocation &allocation);
+
+        // Offset and size are relative to the allocation and get widened to nonCoherentAtomSize. No-ops on coherent memory.
+        VkResult flush(const MemoryAllocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        VkResult invalidate(const MemoryAllocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+        VkMemoryPropertyFlags getMemoryTypeProperties(uint32_t memoryType) const;
+
+        MemoryStats getStats() const;
+        std::vector<MemoryBlockStats> getBlockStats() const;
+
+        // Gives every block, spare ones included, back to the driver. Every allocation must have been freed.
+        void clear();
+
+        virtual ~MemoryAllocator();
+
+      private:
+        const std::shared_ptr<const DeviceCapabilities> capabilities;
+        const VkDevice logical;
+        const VkDeviceSize preferredBlockSize;
+
+        const VkPhysicalDeviceMemoryProperties &memProperties;
+        const VkDeviceSize bufferImageGranularity;
+        const VkDeviceSize nonCoherentAtomSize;
+
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<MemoryBlock>> blocks;
+
+        VkDeviceSize blockSizeFor(uint32_t memoryType) const;
+        VkResult createBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated, ResourceType type, MemoryBlock *&block);
+        std::optional<VkMappedMemoryRange> mappedRange(const MemoryAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) const;
+        VkResult allocateFromType(const VkMemoryRequirements &requirements, uint32_t memoryType, ResourceType type, MemoryAllocation &allocation);
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_MEMORY_ALLOCATOR_HPP__
@@ -0,0 +1,63 @@
+#ifndef __HL_VULKAN_MIPMAP_GENERATOR_HPP__
+#define __HL_VULKAN_MIPMAP_GENERATOR_HPP__
+
+#include <memory>
+#include <string>
+
+#include "command_pool.hpp"
+#include "descriptor_allocator.hpp"
+#include "device.hpp"
+#include "hl_vulkan.hpp"
+#include "image.hpp"
+#include "shader_library.hpp"
+
+namespace HLVulkan {
+
+    // Fills the mip chain of images from their level 0 on the GPU. Formats supporting linear filtered blits go through
+    // Image::recordGenerateMipmaps(), the others through a compute shader (shaders/mipmap.comp) averaging 2x2 texels per level, which needs
+    // SAMPLED and STORAGE usage, a float format with STORAGE_IMAGE support and the shaderStorageImageWriteWithoutFormat feature (enabled on the
+    // device). The compute pipeline is only created the first time it is needed. Either way every level ends up in SHADER_READ_ONLY_OPTIMAL.
+    // Not thread safe.
+    class MipmapGenerator {
+
+      public:
+        MipmapGenerator(Device device, const std::string &shaderFile = "../data/shaders/mipmap_comp.spv");
+
+        MipmapGenerator(const MipmapGenerator &) = delete;
+        MipmapGenerator &operator=(const MipmapGenerator &) = delete;
+
+        // Blocking: submits and waits for the generation. Frees only what it created, what record() created stays alive.
+        VkResult generate(Image &image, CommandPool &commandPool);
+
+        // The per level views and descriptor sets of the compute path stay alive until reset(), which must wait for the command buffer.
+        // VK_ERROR_FEATURE_NOT_PRESENT or VK_ERROR_FORMAT_NOT_SUPPORTED if the compute path is needed and the device can't run it.
+        VkResult record(VkCommandBuffer commandBuffer, Image &image);
+
+        // Frees the views and descriptor sets of every record() so far
+        void reset();
+
+        ~MipmapGenerator();
+
+      private:
+        const Device device;
+        const std::string shaderFile;
+
+        std::shared_ptr<const ShaderModule> shader;
+        VkSampler sampler = VK_NULL_HANDLE;
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE; // Owned by the device's layout cache
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+
+        // Resources of the recorded compute generations, released by reset()
+        DescriptorAllocator descriptorAllocator;
+        std::vector<VkImageView> levelViews;
+
+        VkResult createComputePipeline();
+        VkResult recordGeneration(VkCommandBuffer commandBuffer, Image &image, DescriptorAllocator &allocator, std::vector<VkImageView> &views);
+        VkResult recordCompute(VkCommandBuffer commandBuffer, Image &image, DescriptorAllocator &allocator, std::vector<VkImageView> &views);
+        void destroyViews(std::vector<VkImageView> &views);
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_MIPMAP_GENERATOR_HPP__
@@ -0,0 +1,62 @@
+#ifndef __HL_VULKAN_PARALLEL_RECORDER_HPP__
+#define __HL_VULKAN_PARALLEL_RECORDER_HPP__
+
+#include <functional>
+#include <memory>
+
+#include "command_pool.hpp"
+#include "device.hpp"
+#include "hl_vulkan.hpp"
+#include "queue.hpp"
+#include "worker_pool.hpp"
+
+namespace HLVulkan {
+
+    // Records secondary command buffers on a set of worker threads and stitches them into a primary one with vkCmdExecuteCommands. Each worker
+    // records into its own command pool, one set of pools per frame in flight, so recording never locks and a frame's pools are reset at once
+    // when the frame slot comes around again. A frame is started and recorded from a single thread.
+    class ParallelRecorder {
+
+      public:
+        // Records job index into a secondary command buffer that has already been begun
+        using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, size_t index)>;
+
+        // 0 threads uses one per hardware thread
+        ParallelRecorder(Device device, Queue queue, uint32_t framesInFlight = 2, size_t threadCount = 0);
+
+        ParallelRecorder(const ParallelRecorder &) = delete;
+        ParallelRecorder &operator=(const ParallelRecorder &) = delete;
+
+        // Resets the pools of the frame slot, the GPU must be done with what was recorded in it framesInFlight frames ago
+        VkResult beginFrame(uint32_t frameIndex);
+
+        // A primary command buffer of the current frame, begun for one time submission
+        VkCommandBuffer beginPrimary();
+
+        // Splits jobCount jobs across the workers, waits for them and executes the secondaries in job order. Inside a render pass (begun with
+        // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS), inheritance must name it so that the secondaries continue it.
+        VkResult recordSecondaries(VkCommandBuffer primary, const VkCommandBufferInheritanceInfo &inheritance, size_t jobCount, const RecordFunction &record);
+
+        // Same as above for jobs drawing into the subpass of the render pass
+        VkResult recordSecondaries(VkCommandBuffer primary, VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer, size_t jobCount,
+                                   const RecordFunction &record);
+
+        size_t getThreadCount() const;
+
+      private:
+        const Device device;
+        const Queue queue;
+        const uint32_t framesInFlight;
+
+        WorkerPool workers;
+
+        // framesInFlight slots of one pool per worker, plus one for the primary command buffers
+        std::vector<std::unique_ptr<CommandPool>> pools;
+        uint32_t frameSlot = 0;
+
+        CommandPool &getPool(uint32_t slot, size_t index);
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_PARALLEL_RECORDER_HPP__
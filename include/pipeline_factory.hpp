@@ -1,45 +1,130 @@
 #ifndef __HL_VULKAN_PIPELINE_FACTORY_HPP__
 #define __HL_VULKAN_PIPELINE_FACTORY_HPP__
 
-#include <unordered_set>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 
 #include "device.hpp"
 #include "pipeline_info.hpp"
 #include "pipeline_spec.hpp"
-#include "shader.hpp"
+#include "shader_library.hpp"
+#include "state_key.hpp"
+#include "worker_pool.hpp"
 
 namespace HLVulkan {
 
+    struct PipelineCreationFeedback {
+        // Input: chain VkPipelineCreationFeedbackCreateInfoEXT, requires VK_EXT_pipeline_creation_feedback to be enabled on the device
+        bool requestDriverFeedback = false;
+
+        // Outputs
+        bool valid = false; // The driver filled in the feedback
+        bool cacheHit = false;
+        uint64_t durationNs = 0;
+    };
+
+    struct PipelineCacheStats {
+        size_t loadedBytes = 0;    // Size of the blob accepted from disk, 0 if there was none
+        bool loadRejected = false; // A blob was found but was written by another device or driver
+        uint32_t pipelinesCreated = 0;
+        uint32_t cacheHits = 0;   // Hits and misses are only known with driver feedback enabled
+        uint32_t cacheMisses = 0;
+        uint64_t creationTimeNs = 0;
+    };
+
+    // One entry of a batch compilation, the vertex format and spec must outlive the returned future
+    template <class VertexFormat, class PipelineSpec> struct PipelineRequest {
+        const VertexFormat *vertFormat;
+        const PipelineSpec *spec;
+        VkRenderPass renderPass;
+    };
+
     class PipelineFactory {
 
       public:
-        PipelineFactory(HLVulkan::Device &device);
-
+        // With a cache file, the pipeline cache is loaded from it (if it matches this device) and written back on destruction. Batch compilation
+        // runs on workerCount threads (0 for one per hardware thread), started on the first batch.
+        PipelineFactory(HLVulkan::Device &device, const std::string &cacheFile = "", bool driverFeedback = false, size_t workerCount = 0);
+
+        // Identical requests (same vertex format, spec state and compatible render pass) share one ref counted pipeline, and pipelines with the
+        // same descriptor set layouts share one pipeline layout. State the spec declares dynamic doesn't count, so e.g. specs with dynamic
+        // viewports only differing by their extent share a pipeline. Only render passes created by a RenderPassFactory are known to be
+        // compatible, pipelines for other render passes are never shared. Every call must be balanced by a destroyPipeline().
         template <class VertexFormat, class PipelineSpec>
         PipelineInfo generateNewPipeline(const VertexFormat &vertFormat, const PipelineSpec &spec, VkRenderPass renderPass) {
-            PipelineInfo info = createGraphicsPipeline(device, vertFormat, spec, renderPass);
-            if (info.pipeline != VK_NULL_HANDLE) {
-                addPipelineToSet(info);
+
+            std::optional<StateKey> key = pipelineKey(device, vertFormat, spec, renderPass);
+            VkPipelineLayout layout;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (key) {
+                    std::optional<PipelineInfo> existing = referencePipeline(*key);
+                    if (existing) {
+                        return *existing;
+                    }
+                }
+                layout = acquireLayout(spec.getDescriptorSetLayouts(device));
+            }
+            if (layout == VK_NULL_HANDLE) {
+                return {VK_NULL_HANDLE, VK_NULL_HANDLE};
+            }
+
+            // Compile without holding the lock, the pipeline cache is internally synchronized
+            PipelineCreationFeedback feedback;
+            feedback.requestDriverFeedback = driverFeedback;
+            PipelineInfo info = createGraphicPipeline(device, vertFormat, spec, renderPass, pipelineCache, &feedback, layout);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (info.pipeline == VK_NULL_HANDLE) {
+                releaseLayout(layout);
+                return info;
             }
-            return info;
+            recordFeedback(feedback);
+            return addPipeline(info, key);
         }
 
+        // Compiles the requests in parallel on the factory's worker threads. Each future resolves to what generateNewPipeline() would have
+        // returned for the request, so every resolved pipeline must be balanced by a destroyPipeline().
         template <class VertexFormat, class PipelineSpec>
-        static PipelineInfo createGraphicPipeline(const HLVulkan::Device &device, const VertexFormat &vertFormat, const PipelineSpec &spec,
-                                                  VkRenderPass renderPass) {
-
-            // Load 2 dummy shaders (vertex + fragment). ShaderModules freed automatically when these objects go out of scope
-            HLVulkan::Shader vertexShader{device, "../data/shaders/vk_vert.spv", VK_SHADER_STAGE_VERTEX_BIT};
-            HLVulkan::Shader fragmentShader{device, "../data/shaders/vk_frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT};
+        std::vector<std::future<PipelineInfo>> generateNewPipelines(const std::vector<PipelineRequest<VertexFormat, PipelineSpec>> &requests) {
+            WorkerPool &pool = getWorkerPool();
 
-            // Create shader stages info
-            auto vertexShaderInfo = vertexShader.getShaderStageInfo();
-            auto fragmentShaderInfo = fragmentShader.getShaderStageInfo();
-            if (!vertexShaderInfo || !fragmentShaderInfo) {
-                return {VK_NULL_HANDLE, VK_NULL_HANDLE};
+            std::vector<std::future<PipelineInfo>> futures;
+            futures.reserve(requests.size());
+            for (const auto &request : requests) {
+                futures.push_back(pool.submit([this, request]() { return generateNewPipeline(*request.vertFormat, *request.spec, request.renderPass); }));
             }
+            return futures;
+        }
 
-            std::vector<VkPipelineShaderStageCreateInfo> shaderStages{*vertexShaderInfo, *fragmentShaderInfo};
+        // Without a layout, one is created from the spec's descriptor set layouts and owned by the returned PipelineInfo
+        template <class VertexFormat, class PipelineSpec>
+        static PipelineInfo createGraphicPipeline(const HLVulkan::Device &device, const VertexFormat &vertFormat, const PipelineSpec &spec,
+                                                  VkRenderPass renderPass, VkPipelineCache cache = VK_NULL_HANDLE,
+                                                  PipelineCreationFeedback *feedback = nullptr, VkPipelineLayout layout = VK_NULL_HANDLE) {
+
+            // Shader modules come from the device's library, the references keep them alive until the pipeline is created
+            std::vector<ShaderStage> stages = spec.getShaderStages();
+            std::vector<std::shared_ptr<const ShaderModule>> modules;
+            std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+            for (const ShaderStage &stage : stages) {
+                std::shared_ptr<const ShaderModule> module = device.getShaderLibrary().load(stage.filename);
+                if (!module) {
+                    return {VK_NULL_HANDLE, VK_NULL_HANDLE};
+                }
+                modules.push_back(module);
+
+                VkPipelineShaderStageCreateInfo shaderStageInfo = {};
+                shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+                shaderStageInfo.stage = stage.stage;
+                shaderStageInfo.module = module->getModule();
+                shaderStageInfo.pName = stage.entryPoint.c_str();
+                shaderStages.push_back(shaderStageInfo);
+            }
 
             auto bindingDescription = vertFormat.getBindingDescription();
             auto attributeDescriptions = vertFormat.getAttributeDescriptions();
@@ -55,19 +140,27 @@ namespace HLVulkan {
             // Input assembly
             VkPipelineInputAssemblyStateCreateInfo inputAssembly = spec.getInputAssembly();
 
+            // Dynamic states
+            std::vector<VkDynamicState> dynamicStates = getSupportedDynamicStates(device, spec.getDynamicStates());
+            VkPipelineDynamicStateCreateInfo dynamicState = {};
+            dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+            dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+            dynamicState.pDynamicStates = dynamicStates.data();
+
             // Viewports
             std::vector<VkViewport> viewports = spec.getViewports();
 
             // Scissors
             std::vector<VkRect2D> scissors = spec.getScissors();
 
-            // Viewport state
+            // Viewport state (dynamic viewports and scissors are only counted)
             VkPipelineViewportStateCreateInfo viewportState = {};
             viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
             viewportState.viewportCount = static_cast<uint32_t>(viewports.size());
             viewportState.pViewports = viewports.data();
             viewportState.scissorCount = static_cast<uint32_t>(scissors.size());
             viewportState.pScissors = scissors.data();
+            clearDynamicViewports(dynamicStates, viewportState);
 
             // Rasterizer
             VkPipelineRasterizationStateCreateInfo rasterizer = spec.getRasterizer();
@@ -85,18 +178,10 @@ namespace HLVulkan {
             colorBlending.attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size());
             colorBlending.pAttachments = colorBlendAttachments.data();
 
-            // Descriptor set layouts
-            std::vector<VkDescriptorSetLayout> descriptorSetLayouts = spec.getDescriptorSetLayouts();
-
-            // Pipeline layout (depends on descriptorSetLayouts)
-            VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-            pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-            pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-            pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-
+            // Pipeline layout (depends on the descriptor set layouts)
             VkResult ret;
-            VkPipelineLayout layout;
-            if ((ret = vkCreatePipelineLayout(device.logical, &pipelineLayoutInfo, nullptr, &layout)) != VK_SUCCESS) {
+            const bool ownsLayout = layout == VK_NULL_HANDLE;
+            if (ownsLayout && (ret = createPipelineLayout(device, spec.getDescriptorSetLayouts(device), layout)) != VK_SUCCESS) {
                 return {VK_NULL_HANDLE, VK_NULL_HANDLE};
             }
 
@@ -115,40 +200,169 @@ namespace HLVulkan {
             pipelineInfo.pMultisampleState = &multisampling;
             pipelineInfo.pDepthStencilState = &depthStencil;
             pipelineInfo.pColorBlendState = &colorBlending;
-            pipelineInfo.pDynamicState = nullptr;
+            pipelineInfo.pDynamicState = dynamicStates.empty() ? nullptr : &dynamicState;
             pipelineInfo.layout = layout;
             pipelineInfo.renderPass = renderPass;
             pipelineInfo.subpass = 0;
             pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
             pipelineInfo.basePipelineIndex = -1;
 
+            // Creation feedback (optional)
+            VkPipelineCreationFeedbackEXT pipelineFeedback = {};
+            std::vector<VkPipelineCreationFeedbackEXT> stageFeedbacks(shaderStages.size());
+            VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo = {};
+            if (feedback && feedback->requestDriverFeedback) {
+                feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+                feedbackInfo.pPipelineCreationFeedback = &pipelineFeedback;
+                feedbackInfo.pipelineStageCreationFeedbackCount = static_cast<uint32_t>(stageFeedbacks.size());
+                feedbackInfo.pPipelineStageCreationFeedbacks = stageFeedbacks.data();
+                pipelineInfo.pNext = &feedbackInfo;
+            }
+
             // Create the graphics pipeline
             VkPipeline pipeline;
-            if ((ret = vkCreateGraphicsPipelines(device.logical, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline)) != VK_SUCCESS) {
-                vkDestroyPipelineLayout(device.logical, layout, nullptr);
+            auto start = std::chrono::steady_clock::now();
+            if ((ret = vkCreateGraphicsPipelines(device.logical, cache, 1, &pipelineInfo, nullptr, &pipeline)) != VK_SUCCESS) {
+                if (ownsLayout) {
+                    vkDestroyPipelineLayout(device.logical, layout, nullptr);
+                }
                 return {VK_NULL_HANDLE, VK_NULL_HANDLE};
             }
 
+            if (feedback) {
+                feedback->durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                feedback->valid = (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT) != 0;
+                feedback->cacheHit = (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) != 0;
+            }
+
             // The pipeline has been created successfully
             return {pipeline, layout};
         }
 
+        static VkResult createPipelineLayout(const HLVulkan::Device &device, const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                             VkPipelineLayout &layout);
+
+        // Drops one reference on a pipeline returned by generateNewPipeline(), the pipeline is destroyed with the last one
         void destroyPipeline(VkPipeline pipeline);
 
+        // Writes the pipeline cache to the cache file through a temporary file, so that a crash never leaves a truncated cache behind
+        VkResult saveCache();
+
+        VkPipelineCache getPipelineCache() const;
+        PipelineCacheStats getCacheStats() const;
+
         virtual ~PipelineFactory();
 
       private:
-        struct PipelineInfoHasher {
-            size_t operator()(const PipelineInfo &info) const { return std::hash<VkPipeline>{}(info.pipeline); }
+        struct PipelineRecord {
+            PipelineInfo info;
+            uint32_t refCount;
+            std::optional<StateKey> key; // Unset for specs that can't be described (pNext chains), those are never shared
         };
-        struct PipelineInfoComparator {
-            bool operator()(const PipelineInfo &info1, const PipelineInfo &info2) const { return info1.pipeline == info2.pipeline; }
+        struct LayoutRecord {
+            uint32_t refCount;
+            StateKey key;
         };
 
         HLVulkan::Device device;
-        std::unordered_set<PipelineInfo, PipelineInfoHasher, PipelineInfoComparator> createdPipelines;
+        std::unordered_map<VkPipeline, PipelineRecord> pipelines;
+        std::unordered_map<StateKey, VkPipeline, StateKeyHasher> pipelinesByKey;
+        std::unordered_map<VkPipelineLayout, LayoutRecord> layouts;
+        std::unordered_map<StateKey, VkPipelineLayout, StateKeyHasher> layoutsByKey;
+
+        const std::string cacheFile;
+        const bool driverFeedback;
+        const size_t workerCount;
+        std::unique_ptr<WorkerPool> workers;
+
+        // Guards the pipeline and layout maps and the stats, never held while compiling
+        mutable std::mutex mutex;
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+        PipelineCacheStats cacheStats;
+
+        std::vector<char> loadCacheData();
+        void recordFeedback(const PipelineCreationFeedback &feedback);
+        WorkerPool &getWorkerPool();
+
+        // The following expect the mutex to be held
+        std::optional<PipelineInfo> referencePipeline(const StateKey &key);
+        PipelineInfo addPipeline(const PipelineInfo &info, const std::optional<StateKey> &key);
+        VkPipelineLayout acquireLayout(const std::vector<VkDescriptorSetLayout> &setLayouts);
+        void releaseLayout(VkPipelineLayout layout);
+
+        // Sorted dynamic states of a spec, without the extended ones if the device doesn't support them
+        static std::vector<VkDynamicState> getSupportedDynamicStates(const HLVulkan::Device &device, const std::vector<VkDynamicState> &states);
+
+        // Drops the viewports and scissors the dynamic states override. Dynamic ones still count (at least one), unless their count is dynamic too.
+        static void clearDynamicViewports(const std::vector<VkDynamicState> &states, VkPipelineViewportStateCreateInfo &viewportState);
+
+        // Resets the fields the dynamic states override, so that specs only differing by them get the same key. A dynamic topology only keeps
+        // its class (points, lines, triangles or patches), which the pipeline still fixes.
+        static void clearDynamicFields(const std::vector<VkDynamicState> &states, VkVertexInputBindingDescription &binding,
+                                       VkPipelineInputAssemblyStateCreateInfo &inputAssembly, VkPipelineRasterizationStateCreateInfo &rasterizer,
+                                       VkPipelineDepthStencilStateCreateInfo &depthStencil);
+
+        template <class VertexFormat, class PipelineSpec>
+        static std::optional<StateKey> pipelineKey(const HLVulkan::Device &device, const VertexFormat &vertFormat, const PipelineSpec &spec,
+                                                   VkRenderPass renderPass) {
+            // Render passes are identified by compatibility, a destroyed render pass's handle may come back for an unrelated one
+            std::optional<StateKey> renderPassKey = device.getRenderPassRegistry().getCompatibilityKey(renderPass);
+            if (!renderPassKey) {
+                return std::nullopt;
+            }
+
+            StateKey key;
+
+            // Shaders are identified by their library module, which copies of the same SPIR-V under different paths share, and which different
+            // SPIR-V never shares even when the hashes collide
+            std::vector<ShaderStage> stages = spec.getShaderStages();
+            key.add(static_cast<uint32_t>(stages.size()));
+            for (const ShaderStage &stage : stages) {
+                std::shared_ptr<const ShaderModule> module = device.getShaderLibrary().load(stage.filename);
+                if (!module) {
+                    return std::nullopt;
+                }
+                key.add(stage.stage).add(stage.entryPoint).add(module->getId());
+            }
+
+            // Only the viewport and scissor counts matter when they're dynamic
+            std::vector<VkDynamicState> dynamicStates = getSupportedDynamicStates(device, spec.getDynamicStates());
+            std::vector<VkViewport> viewports = spec.getViewports();
+            std::vector<VkRect2D> scissors = spec.getScissors();
+            VkPipelineViewportStateCreateInfo viewportState = {};
+            viewportState.viewportCount = static_cast<uint32_t>(viewports.size());
+            viewportState.pViewports = viewports.data();
+            viewportState.scissorCount = static_cast<uint32_t>(scissors.size());
+            viewportState.pScissors = scissors.data();
+            clearDynamicViewports(dynamicStates, viewportState);
+            viewports.resize(viewportState.pViewports ? viewportState.viewportCount : 0);
+            scissors.resize(viewportState.pScissors ? viewportState.scissorCount : 0);
 
-        void addPipelineToSet(PipelineInfo &info);
+            auto bindingDescription = vertFormat.getBindingDescription();
+            VkPipelineInputAssemblyStateCreateInfo inputAssembly = spec.getInputAssembly();
+            VkPipelineRasterizationStateCreateInfo rasterizer = spec.getRasterizer();
+            VkPipelineDepthStencilStateCreateInfo depthStencil = spec.getDepthStencil();
+            clearDynamicFields(dynamicStates, bindingDescription, inputAssembly, rasterizer, depthStencil);
+
+            key.add(bindingDescription)
+                .add(vertFormat.getAttributeDescriptions())
+                .add(inputAssembly)
+                .add(viewportState.viewportCount)
+                .add(viewports)
+                .add(viewportState.scissorCount)
+                .add(scissors)
+                .add(rasterizer)
+                .add(spec.getMultisampling())
+                .add(spec.getColorBlending())
+                .add(spec.getDescriptorSetLayouts(device))
+                .add(depthStencil)
+                .add(dynamicStates)
+                .add(*renderPassKey);
+            if (!key.isValid()) {
+                return std::nullopt;
+            }
+            return key;
+        }
     };
 
 } // namespace HLVulkan
@@ -9,9 +9,18 @@
 
 namespace HLVulkan {
 
+    struct Device;
+
+    struct ShaderStage {
+        std::string filename;
+        VkShaderStageFlagBits stage;
+        std::string entryPoint = "main";
+    };
+
     class PipelineSpec {
 
       public:
+        std::vector<ShaderStage> getShaderStages() const;
         VkPipelineInputAssemblyStateCreateInfo getInputAssembly() const;
         std::vector<VkViewport> getViewports() const;
         std::vector<VkRect2D> getScissors() const;
@@ -19,19 +28,32 @@ namespace HLVulkan {
         VkPipelineMultisampleStateCreateInfo getMultisampling() const;
         std::vector<VkPipelineColorBlendAttachmentState> getColorBlending() const;
         std::vector<VkDescriptorSetLayout> getDescriptorSetLayouts() const;
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> getDescriptorSetBindings() const;
+
+        // Layouts of the spec's bindings from the device's layout cache if it describes any, its own layouts otherwise
+        std::vector<VkDescriptorSetLayout> getDescriptorSetLayouts(const Device &device) const;
         VkPipelineDepthStencilStateCreateInfo getDepthStencil() const;
+        std::vector<VkDynamicState> getDynamicStates() const;
 
         virtual ~PipelineSpec();
 
       private:
+        // Defaults to the vk_vert.spv/vk_frag.spv pair every pipeline used before specs could choose their shaders
+        virtual std::vector<ShaderStage> createShaderStages() const;
         virtual VkPipelineInputAssemblyStateCreateInfo createInputAssembly() const = 0;
         virtual std::vector<VkViewport> createViewports() const = 0;
         virtual std::vector<VkRect2D> createScissors() const = 0;
         virtual VkPipelineRasterizationStateCreateInfo createRasterizer() const = 0;
         virtual VkPipelineMultisampleStateCreateInfo createMultisampling() const = 0;
         virtual std::vector<VkPipelineColorBlendAttachmentState> createColorBlending() const = 0;
-        virtual std::vector<VkDescriptorSetLayout> createDescriptorSetLayouts() const = 0;
+        // Either raw layouts, owned by the spec, or the bindings of each set, the layouts then belong to the device. Neither by default.
+        virtual std::vector<VkDescriptorSetLayout> createDescriptorSetLayouts() const;
+        virtual std::vector<std::vector<VkDescriptorSetLayoutBinding>> createDescriptorSetBindings() const;
         virtual VkPipelineDepthStencilStateCreateInfo createDepthStencil() const = 0;
+        // State set while recording instead of baked into the pipeline, e.g. viewport and scissor so that resizes don't recreate pipelines. The
+        // extended dynamic state ones are dropped on devices without VK_EXT_extended_dynamic_state, the spec's values are then baked. None by
+        // default.
+        virtual std::vector<VkDynamicState> createDynamicStates() const;
     };
 
 } // namespace HLVulkan
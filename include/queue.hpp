@@ -1,16 +1,22 @@
 #ifndef __HL_VULKAN_QUEUE_HPP__
 #define __HL_VULKAN_QUEUE_HPP__
 
+#include <memory>
+#include <mutex>
+
 #include "hl_vulkan.hpp"
 
 namespace HLVulkan {
 
+    // A VkQueue must be externally synchronized, so every submission and wait of the library holds mutex while it uses the queue. Copies share
+    // the mutex: a VkQueue used by several objects must be wrapped once and then copied, and code using it directly must hold the mutex too.
     struct Queue {
         VkQueue queue;
         uint32_t family;
+        std::shared_ptr<std::mutex> mutex;
 
-        Queue(VkQueue queue, uint32_t family) : queue(queue), family(family){};
-        Queue(const Queue &queue) : queue(queue.queue), family(queue.family){};
+        Queue(VkQueue queue, uint32_t family) : queue(queue), family(family), mutex(std::make_shared<std::mutex>()){};
+        Queue(const Queue &queue) : queue(queue.queue), family(queue.family), mutex(queue.mutex){};
     };
 
 } // namespace HLVulkan
@@ -0,0 +1,181 @@
+#ifndef __HL_VULKAN_RENDER_GRAPH_HPP__
+#define __HL_VULKAN_RENDER_GRAPH_HPP__
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "buffer.hpp"
+#include "device.hpp"
+#include "hl_vulkan.hpp"
+#include "image.hpp"
+#include "render_pass_factory.hpp"
+#include "resource_state.hpp"
+
+namespace HLVulkan {
+
+    // An image created and owned by the graph, only alive during the passes using it
+    struct RenderGraphImageDesc {
+        VkExtent2D extent;
+        VkFormat format;
+        VkImageUsageFlags usage;
+        VkImageAspectFlags aspect;
+    };
+
+    // A frame described as passes declaring the images and buffers they read and write, in submission order. compile() culls the passes whose
+    // results are never used (passes writing imported resources or with side effects are kept), orders the others, derives the render pass of
+    // each raster pass (attachments loaded and stored only if their content is used) and lets transient images whose lifetimes don't overlap
+    // share memory. execute() records each pass behind the barriers its accesses need, derived from the tracked state of the resources.
+    // Recompiling keeps what the previous compilation created alive for framesInFlight more frames, since earlier frames may still use it.
+    // Not thread safe.
+    class RenderGraph {
+
+      public:
+        using ResourceId = uint32_t;
+        using PassId = uint32_t;
+
+        // Records the pass, inside its render pass for raster passes
+        using ExecuteFunction = std::function<void(VkCommandBuffer commandBuffer)>;
+
+        class PassBuilder {
+
+          public:
+            PassBuilder &read(ResourceId resource, const ResourceAccess &access);
+            PassBuilder &write(ResourceId resource, const ResourceAccess &access);
+
+            // Attachments of a raster pass, in attachment order. Without a clear value the previous content is kept (if there is any).
+            PassBuilder &colorAttachment(ResourceId image, std::optional<VkClearColorValue> clear = std::nullopt);
+            PassBuilder &depthAttachment(ResourceId image, std::optional<VkClearDepthStencilValue> clear = std::nullopt);
+
+            // Kept by compile() even if nothing uses what it writes
+            PassBuilder &sideEffect();
+
+          private:
+            friend class RenderGraph;
+
+            RenderGraph &graph;
+            const PassId pass;
+
+            PassBuilder(RenderGraph &graph, PassId pass);
+        };
+
+        RenderGraph(Device device, uint32_t framesInFlight = 2);
+
+        RenderGraph(const RenderGraph &) = delete;
+        RenderGraph &operator=(const RenderGraph &) = delete;
+
+        // Resources living outside the graph, their content is assumed to be used after it
+        ResourceId importImage(Image &image);
+        ResourceId importBuffer(Buffer &buffer);
+
+        ResourceId createImage(const RenderGraphImageDesc &desc);
+
+        PassId addPass(const std::string &name, const std::function<void(PassBuilder &builder)> &setup, const ExecuteFunction &execute);
+
+        // Must be called again after adding passes or resources. The render passes and transient images of the previous compilation are
+        // destroyed framesInFlight frames later.
+        VkResult compile();
+
+        // Starts a new frame: what recompiling replaced framesInFlight frames ago is destroyed
+        void nextFrame();
+
+        // Records the passes in execution order
+        void execute(VkCommandBuffer commandBuffer);
+
+        // Transient images only exist between compile() and the next compilation
+        Image &getImage(ResourceId resource) const;
+        Buffer &getBuffer(ResourceId resource) const;
+
+        const std::vector<PassId> &getExecutionOrder() const;
+        bool isCulled(PassId pass) const;
+        const std::string &getPassName(PassId pass) const;
+
+        // Render pass the pipelines of a raster pass are created for, VK_NULL_HANDLE for other passes and culled ones. Changes on compile().
+        VkRenderPass getRenderPass(PassId pass) const;
+
+        // Memory bound to transient images, with and without aliasing
+        VkDeviceSize getTransientMemorySize() const;
+        VkDeviceSize getTransientRequestedSize() const;
+
+        // The GPU must be done with every frame using the graph
+        ~RenderGraph();
+
+      private:
+        enum class AccessType { READ, WRITE, ATTACHMENT };
+
+        struct Access {
+            ResourceId resource;
+            ResourceAccess access;
+            AccessType type;
+            std::optional<VkClearValue> clear; // Attachments only
+        };
+
+        struct Resource {
+            Image *image = nullptr;
+            Buffer *buffer = nullptr;
+            std::optional<RenderGraphImageDesc> desc; // Transient images only
+
+            // Set by compile() for transient images
+            std::unique_ptr<Image> transient;
+            uint32_t firstUse = 0;
+            uint32_t lastUse = 0;
+            uint32_t slot = 0;
+        };
+
+        // A memory range shared by transient images, with the scope of every access to it
+        struct MemorySlot {
+            VkMemoryRequirements requirements;
+            std::vector<std::pair<uint32_t, uint32_t>> lifetimes;
+            bool lazy;
+            MemoryAllocation allocation;
+            VkPipelineStageFlags stages = 0;
+            VkAccessFlags writeAccess = 0;
+        };
+
+        struct Pass {
+            std::string name;
+            ExecuteFunction execute;
+            std::vector<Access> accesses;
+            bool sideEffect = false;
+
+            // Set by compile()
+            bool culled = false;
+            VkRenderPass renderPass = VK_NULL_HANDLE;
+        };
+
+        // What a compilation created, destroyed once no frame in flight can use it
+        struct Retired {
+            uint64_t frame;
+            std::vector<VkRenderPass> renderPasses;
+            std::vector<std::unique_ptr<Image>> images;
+            std::vector<MemoryAllocation> allocations;
+        };
+
+        Device device;
+        RenderPassFactory renderPassFactory;
+        const uint32_t framesInFlight;
+        uint64_t frame = 0;
+        std::deque<Retired> retired;
+
+        std::vector<Resource> resources;
+        std::vector<Pass> passes;
+        std::vector<PassId> order;
+        std::vector<MemorySlot> slots;
+        VkDeviceSize requestedSize = 0;
+        bool compiled = false;
+
+        void addAccess(PassId pass, ResourceId resource, const ResourceAccess &access, AccessType type, std::optional<VkClearValue> clear);
+        void release();
+        void destroy(Retired &objects);
+        void cull(const std::vector<std::vector<PassId>> &producers);
+        void sortPasses(const std::vector<std::vector<PassId>> &dependencies);
+        VkResult allocateTransients();
+        VkRenderPass createRenderPass(const Pass &pass, uint32_t position);
+        void recordPass(VkCommandBuffer commandBuffer, const Pass &pass, uint32_t position);
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_RENDER_GRAPH_HPP__
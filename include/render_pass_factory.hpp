@@ -1,23 +1,37 @@
 #ifndef __HL_VULKAN_RENDER_PASS_FACTORY_HPP__
 #define __HL_VULKAN_RENDER_PASS_FACTORY_HPP__
 
-#include <unordered_set>
+#include <unordered_map>
 #include <vector>
 
 #include "device.hpp"
 #include "hl_vulkan.hpp"
+#include "state_key.hpp"
 
 namespace HLVulkan {
 
+    // Render passes are shared between identical specs (same attachments, subpasses and dependencies), so that pipelines and framebuffers built
+    // against them are shared too. Live render passes are listed in the device's RenderPassRegistry with their compatibility key. Not thread safe.
     class RenderPassFactory {
 
       public:
         RenderPassFactory(HLVulkan::Device &device);
 
+        // Identical specs share one ref counted render pass, every call must be balanced by a destroyRenderPass()
         template <class RenderPassSpec> VkRenderPass generateNewRenderPass(const RenderPassSpec &spec) {
+
+            StateKey key;
+            key.add(spec.getAttachments()).add(spec.getSubpasses()).add(spec.getDependencies());
+
+            auto it = renderPassesByKey.find(key);
+            if (it != renderPassesByKey.end()) {
+                renderPasses.at(it->second).refCount++;
+                return it->second;
+            }
+
             VkRenderPass renderPass = createRenderPass(device, spec);
             if (renderPass != VK_NULL_HANDLE) {
-                addRenderPassToSet(renderPass);
+                addRenderPass(renderPass, key, getCompatibilityKey(spec.getAttachments(), spec.getSubpasses(), spec.getDependencies()));
             }
             return renderPass;
         }
@@ -45,22 +59,29 @@ namespace HLVulkan {
             return renderPass;
         }
 
+        // Render passes are compatible when they only differ in attachment layouts and load and store operations: their subpasses must reference
+        // attachments of the same formats, sample counts and flags, and passes of several subpasses need the same dependencies. A pipeline
+        // created for one can be used with all the others.
+        static StateKey getCompatibilityKey(const std::vector<VkAttachmentDescription> &attachments, const std::vector<VkSubpassDescription> &subpasses,
+                                            const std::vector<VkSubpassDependency> &dependencies);
+
+        // Drops one reference on a render pass returned by generateNewRenderPass(). The render pass and the device's cached framebuffers using it
+        // are destroyed with the last one.
         void destroyRenderPass(VkRenderPass renderPass);
 
         virtual ~RenderPassFactory();
 
       private:
-        struct RenderPassHasher {
-            size_t operator()(const VkRenderPass &renderPass) const { return std::hash<VkRenderPass>()(renderPass); }
-        };
-        struct RenderPassComparator {
-            bool operator()(const VkRenderPass &renderPass1, const VkRenderPass &renderPass2) const { return renderPass1 == renderPass2; }
+        struct RenderPassRecord {
+            uint32_t refCount;
+            StateKey key;
         };
 
         HLVulkan::Device device;
-        std::unordered_set<VkRenderPass, RenderPassHasher, RenderPassComparator> createdRenderPasses;
+        std::unordered_map<VkRenderPass, RenderPassRecord> renderPasses;
+        std::unordered_map<StateKey, VkRenderPass, StateKeyHasher> renderPassesByKey;
 
-        void addRenderPassToSet(VkRenderPass &renderPass);
+        void addRenderPass(VkRenderPass renderPass, const StateKey &key, const StateKey &compatibilityKey);
     };
 
 } // namespace HLVulkan
@@ -0,0 +1,36 @@
+#ifndef __HL_VULKAN_RENDER_PASS_REGISTRY_HPP__
+#define __HL_VULKAN_RENDER_PASS_REGISTRY_HPP__
+
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "hl_vulkan.hpp"
+#include "state_key.hpp"
+
+namespace HLVulkan {
+
+    // Compatibility keys of the live render passes created by a RenderPassFactory, so that objects keyed on a render pass (pipelines) are keyed
+    // on what makes render passes compatible rather than on a handle the driver may hand out again once it's destroyed. Thread safe.
+    class RenderPassRegistry {
+
+      public:
+        RenderPassRegistry() = default;
+
+        RenderPassRegistry(const RenderPassRegistry &) = delete;
+        RenderPassRegistry &operator=(const RenderPassRegistry &) = delete;
+
+        void add(VkRenderPass renderPass, const StateKey &compatibilityKey);
+        void remove(VkRenderPass renderPass);
+
+        // Unset for render passes created outside a RenderPassFactory
+        std::optional<StateKey> getCompatibilityKey(VkRenderPass renderPass) const;
+
+      private:
+        mutable std::mutex mutex;
+        std::unordered_map<VkRenderPass, StateKey> keys;
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_RENDER_PASS_REGISTRY_HPP__
@@ -9,6 +9,8 @@
 
 namespace HLVulkan {
 
+    class Image;
+
     class RenderPassSpec {
 
       public:
@@ -16,6 +18,18 @@ namespace HLVulkan {
         std::vector<VkSubpassDescription> getSubpasses() const;
         std::vector<VkSubpassDependency> getDependencies() const;
 
+        // Attachment whose content only lives during the render pass: cleared (or left undefined) on load and never stored, which lets tilers
+        // keep it on chip. Transient images may only back such attachments.
+        static VkAttachmentDescription createTransientAttachment(VkFormat format, VkImageLayout layout, bool clear = true,
+                                                                 VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+
+        // Whether the attachment neither loads nor stores its content (stencil included for formats that have one)
+        static bool isTransient(const VkAttachmentDescription &attachment);
+
+        // Checks that every transient image backs a transient attachment, images being given in attachment order (null for views not owned by an
+        // Image). Asserts on mismatch in debug builds.
+        bool checkTransientAttachments(const std::vector<const Image *> &images) const;
+
         virtual ~RenderPassSpec();
 
       private:
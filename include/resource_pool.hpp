@@ -0,0 +1,83 @@
+#ifndef __HL_VULKAN_RESOURCE_POOL_HPP__
+#define __HL_VULKAN_RESOURCE_POOL_HPP__
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+#include "buffer.hpp"
+#include "device.hpp"
+#include "hl_vulkan.hpp"
+#include "image.hpp"
+#include "state_key.hpp"
+
+namespace HLVulkan {
+
+    struct ResourcePoolStats {
+        uint64_t hits = 0;    // Acquisitions served by a released resource
+        uint64_t misses = 0;  // Acquisitions that created a resource
+        uint64_t trimmed = 0; // Resources destroyed after staying unused for idleFrames
+        size_t freeImages = 0;
+        size_t freeBuffers = 0;
+        VkDeviceSize freeBytes = 0; // Memory held by the free resources
+    };
+
+    // Recycles images and buffers keyed by their description (extent, format, tiling, usage, aspect, mip levels and memory properties for
+    // images, size, usage, memory properties and persistent mapping for buffers), so that resizes and per frame scratch resources don't create
+    // and destroy driver objects over and over. A released resource is only handed out again reuseDelay frames later, once the GPU is done with
+    // it (reuseDelay must cover the frames in flight), and destroyed if nobody wants it for idleFrames frames. Only EXCLUSIVE resources owning
+    // their memory can be pooled. Not thread safe.
+    class ResourcePool {
+
+      public:
+        ResourcePool(Device device, uint32_t reuseDelay = 2, uint32_t idleFrames = 120);
+
+        ResourcePool(const ResourcePool &) = delete;
+        ResourcePool &operator=(const ResourcePool &) = delete;
+
+        // Same parameters as the Image and Buffer constructors. A recycled image starts over in the UNDEFINED layout, its content is lost.
+        std::unique_ptr<Image> acquireImage(VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                                            VkMemoryPropertyFlags properties, uint32_t mipLevels = 1);
+        std::unique_ptr<Buffer> acquireBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool persistentMap = false);
+
+        // The GPU may still use the resource during the current frame
+        void release(std::unique_ptr<Image> image);
+        void release(std::unique_ptr<Buffer> buffer);
+
+        // Starts a new frame: resources released reuseDelay frames ago become available, the ones idle for idleFrames are destroyed
+        void nextFrame();
+
+        // Destroys every free resource, none may still be in use by the GPU
+        void trim();
+
+        ResourcePoolStats getStats() const;
+
+      private:
+        template <class Resource> struct FreeResource {
+            std::unique_ptr<Resource> resource;
+            uint64_t releaseFrame;
+        };
+
+        // Oldest release first
+        template <class Resource> using FreeList = std::unordered_map<StateKey, std::deque<FreeResource<Resource>>, StateKeyHasher>;
+
+        const Device device;
+        const uint32_t reuseDelay;
+        const uint32_t idleFrames;
+
+        uint64_t frame = 0;
+        FreeList<Image> freeImages;
+        FreeList<Buffer> freeBuffers;
+        ResourcePoolStats stats;
+
+        static StateKey imageKey(VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                                 VkMemoryPropertyFlags properties, uint32_t mipLevels);
+        static StateKey bufferKey(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool persistentMap);
+
+        template <class Resource> std::unique_ptr<Resource> reuse(FreeList<Resource> &freeList, const StateKey &key);
+        template <class Resource> void trimIdle(FreeList<Resource> &freeList);
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_RESOURCE_POOL_HPP__
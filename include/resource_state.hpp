@@ -0,0 +1,48 @@
+#ifndef __HL_VULKAN_RESOURCE_STATE_HPP__
+#define __HL_VULKAN_RESOURCE_STATE_HPP__
+
+#include "hl_vulkan.hpp"
+
+namespace HLVulkan {
+
+    // How a command is about to use a buffer or an image subresource
+    struct ResourceAccess {
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED; // Ignored for buffers
+
+        bool isWrite() const;
+
+        // The usual access of an image in the layout, e.g. TRANSFER_DST_OPTIMAL is a transfer write
+        static ResourceAccess forLayout(VkImageLayout layout);
+    };
+
+    // What the commands recorded so far did to a buffer or an image subresource. Tracking follows recording order, so command buffers touching
+    // the same resources must be submitted in the order they were recorded in.
+    struct ResourceState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // Last write, and where it has been made visible since
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags visibleStages = 0;
+        VkAccessFlags visibleAccess = 0;
+
+        // Stages that read the resource since the last write, a later write must wait for them
+        VkPipelineStageFlags readStages = 0;
+
+        // Between a queue family ownership release and the matching acquire, with the layout the release transitioned from
+        bool released = false;
+        VkImageLayout releasedLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // Updates the state for the access. Returns false if no barrier is needed, otherwise the source scope of the barrier to record.
+        bool transition(const ResourceAccess &next, bool trackLayout, VkPipelineStageFlags &srcStages, VkAccessFlags &srcAccess);
+
+        // Updates the state for an access recorded without a transition of its own, e.g. a copy the caller transitioned for beforehand, so
+        // that later transitions still wait for it
+        void record(const ResourceAccess &access, bool trackLayout);
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_RESOURCE_STATE_HPP__
@@ -0,0 +1,53 @@
+#ifndef __HL_VULKAN_RING_BUFFER_HPP__
+#define __HL_VULKAN_RING_BUFFER_HPP__
+
+#include <deque>
+
+#include "buffer.hpp"
+#include "device.hpp"
+#include "hl_vulkan.hpp"
+
+namespace HLVulkan {
+
+    struct RingAllocation {
+        void *data;
+        VkDeviceSize offset;
+        VkBuffer buffer;
+    };
+
+    // Persistently mapped buffer handing out per-frame slices for dynamic data (uniforms, instance data...). Slices of a frame are recycled
+    // framesInFlight frames later, once the caller has waited for that frame's GPU work.
+    class RingBuffer {
+
+      public:
+        RingBuffer(Device device, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t framesInFlight,
+                   VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+        // Reclaims the slices of the oldest frame once framesInFlight frames have been recorded. Its GPU work must be complete.
+        void beginFrame();
+
+        std::optional<RingAllocation> allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+
+        // Flushes this frame's slices if the memory isn't coherent
+        VkResult endFrame();
+
+        VkBuffer getBuffer();
+        VkDeviceSize getCapacity() const;
+        VkDeviceSize getUsedBytes() const;
+
+      private:
+        Buffer buffer;
+        const VkDeviceSize capacity;
+        const uint32_t framesInFlight;
+        const bool coherent;
+
+        // Monotonic byte counters, their position in the buffer is the value modulo the capacity
+        VkDeviceSize head = 0;
+        VkDeviceSize tail = 0;
+        VkDeviceSize frameStart = 0;
+        std::deque<VkDeviceSize> frameEnds;
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_RING_BUFFER_HPP__
@@ -3,6 +3,7 @@
 
 #include "device.hpp"
 #include "hl_vulkan.hpp"
+#include "shader_archive.hpp"
 
 namespace HLVulkan {
 
@@ -11,6 +12,7 @@ namespace HLVulkan {
       private:
         Device device;
         std::string filename;
+        std::shared_ptr<const ShaderArchive> archive;
         VkShaderStageFlagBits stage;
         const std::string pName;
 
@@ -21,6 +23,10 @@ namespace HLVulkan {
 
         Shader(Device device, const std::string &filename, VkShaderStageFlagBits stage, const std::string & = "main");
 
+        // Loads the shader named name from the archive, the module is created straight from the archive's mapping
+        Shader(Device device, std::shared_ptr<const ShaderArchive> archive, const std::string &name, VkShaderStageFlagBits stage,
+               const std::string & = "main");
+
         std::optional<VkPipelineShaderStageCreateInfo> getShaderStageInfo();
 
         ~Shader();
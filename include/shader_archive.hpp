@@ -0,0 +1,88 @@
+#ifndef __HL_VULKAN_SHADER_ARCHIVE_HPP__
+#define __HL_VULKAN_SHADER_ARCHIVE_HPP__
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
+#include "hl_vulkan.hpp"
+
+namespace HLVulkan {
+
+    // Archive layout, all fields little-endian:
+    //   header   magic, version, entry count, string table size                  4 x uint32
+    //   index    per entry: code offset, code size, code hash, name offset, name size  3 x uint64 + 2 x uint32
+    //   strings  entry names, not null terminated
+    //   blobs    SPIR-V code, each starting on a 4 byte boundary
+
+    struct ShaderArchiveEntry {
+        const uint32_t *code; // Points into the archive, valid as long as the archive is
+        size_t size;          // In bytes
+        uint64_t hash;        // hashShaderCode() of the code
+    };
+
+    // Read-only view on a packed shader archive. The file is mapped in memory, so that SPIR-V can be handed to vkCreateShaderModule without
+    // being copied (platforms without mmap read the whole archive once instead).
+    class ShaderArchive {
+
+      public:
+        static constexpr uint32_t MAGIC = 0x41534c48; // "HLSA"
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t HEADER_SIZE = 16;
+        static constexpr size_t INDEX_ENTRY_SIZE = 32;
+
+        // Returns nullptr if the file can't be opened or isn't a valid archive
+        static std::shared_ptr<const ShaderArchive> open(const std::string &filename);
+
+        ShaderArchive(const ShaderArchive &) = delete;
+        ShaderArchive &operator=(const ShaderArchive &) = delete;
+
+        // The blob is checked against its hash the first time it's found, a corrupted one is reported and never returned
+        std::optional<ShaderArchiveEntry> find(const std::string &name) const;
+
+        std::vector<std::string> getNames() const;
+        const std::string &getFilename() const;
+
+        ~ShaderArchive();
+
+      private:
+        const std::string filename;
+        const char *data = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+        std::vector<uint32_t> fallback; // Backs data when the file couldn't be mapped
+
+        // Blobs are only hashed when they're first looked up, so that opening an archive doesn't read every page of the mapping
+        enum class Verification : uint8_t { PENDING, VALID, CORRUPTED };
+        struct Blob {
+            ShaderArchiveEntry shader;
+            mutable std::atomic<Verification> verification{Verification::PENDING};
+
+            explicit Blob(const ShaderArchiveEntry &shader) : shader(shader) {}
+        };
+        std::unordered_map<std::string, Blob> entries;
+
+        explicit ShaderArchive(const std::string &filename);
+
+        bool load();
+        bool parse();
+    };
+
+    // Packs SPIR-V blobs into an archive readable by ShaderArchive
+    class ShaderArchiveBuilder {
+
+      public:
+        // Fails if the name is already used or the code isn't a non-zero number of SPIR-V words
+        bool add(const std::string &name, const std::vector<char> &code);
+        bool addFile(const std::string &name, const std::string &filename);
+
+        // Writes through a temporary file, so that a failure never leaves a truncated archive behind
+        bool write(const std::string &filename) const;
+
+      private:
+        std::vector<std::pair<std::string, std::vector<char>>> shaders;
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_SHADER_ARCHIVE_HPP__
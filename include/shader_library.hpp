@@ -0,0 +1,101 @@
+#ifndef __HL_VULKAN_SHADER_LIBRARY_HPP__
+#define __HL_VULKAN_SHADER_LIBRARY_HPP__
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "hl_vulkan.hpp"
+#include "shader_archive.hpp"
+
+namespace HLVulkan {
+
+    // Content hash identifying SPIR-V in the library and in shader archives
+    uint64_t hashShaderCode(const char *code, size_t size);
+
+    // Shader module shared between every pipeline using the same SPIR-V, destroyed with its last reference. Keeps the buffer holding its SPIR-V
+    // alive (the archive it was found in, or the file content) so that the library can tell apart different code with the same hash.
+    class ShaderModule {
+
+      public:
+        ShaderModule(VkDevice device, VkShaderModule module, uint64_t id, uint64_t hash, std::shared_ptr<const void> source, const uint32_t *code,
+                     size_t size);
+
+        ShaderModule(const ShaderModule &) = delete;
+        ShaderModule &operator=(const ShaderModule &) = delete;
+
+        VkShaderModule getModule() const;
+
+        // Unique within the library and never reused, unlike the handle of a destroyed module
+        uint64_t getId() const;
+
+        // Hash of the SPIR-V the module was created from
+        uint64_t getHash() const;
+
+        size_t getCodeSize() const;
+
+        // Returns true if the module was created from exactly this SPIR-V
+        bool hasCode(const uint32_t *code, size_t size) const;
+
+        ~ShaderModule();
+
+      private:
+        const VkDevice device;
+        const VkShaderModule module;
+        const uint64_t id;
+        const uint64_t hash;
+        const std::shared_ptr<const void> source;
+        const uint32_t *const code;
+        const size_t size;
+    };
+
+    struct ShaderLibraryStats {
+        uint32_t fileReads = 0;
+        uint32_t modulesCreated = 0;
+        uint32_t moduleCount = 0; // Modules currently held by the library
+    };
+
+    // Loads SPIR-V once per path and creates one module per unique content. Paths are looked up in the mounted archives first, then on disk.
+    // The library keeps every module it created alive until releaseUnused() is called. Thread safe.
+    class ShaderLibrary {
+
+      public:
+        explicit ShaderLibrary(VkDevice device);
+
+        ShaderLibrary(const ShaderLibrary &) = delete;
+        ShaderLibrary &operator=(const ShaderLibrary &) = delete;
+
+        // Archives mounted first take precedence
+        void mountArchive(std::shared_ptr<const ShaderArchive> archive);
+
+        // Returns nullptr if the file can't be read or the module can't be created
+        std::shared_ptr<const ShaderModule> load(const std::string &filename);
+
+        // Same as load() for SPIR-V already in memory, the code must be 4 byte aligned
+        std::shared_ptr<const ShaderModule> loadCode(const char *code, size_t size);
+
+        // Destroys the modules not referenced outside of the library, returns how many were destroyed
+        size_t releaseUnused();
+
+        // Destroys every module, none may still be referenced outside of the library
+        void clear();
+
+        ShaderLibraryStats getStats() const;
+
+      private:
+        const VkDevice device;
+
+        mutable std::mutex mutex;
+        std::vector<std::shared_ptr<const ShaderArchive>> archives;
+        std::unordered_map<std::string, std::weak_ptr<const ShaderModule>> modulesByPath;
+        std::unordered_multimap<uint64_t, std::shared_ptr<const ShaderModule>> modulesByHash;
+        ShaderLibraryStats stats;
+        uint64_t nextModuleId = 0;
+
+        // Expects the mutex to be held. The code must stay valid as long as the source does, it's copied when there's no source.
+        std::shared_ptr<const ShaderModule> findOrCreate(const uint32_t *code, size_t size, uint64_t hash, std::shared_ptr<const void> source);
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_SHADER_LIBRARY_HPP__
@@ -0,0 +1,73 @@
+#ifndef __HL_VULKAN_STATE_KEY_HPP__
+#define __HL_VULKAN_STATE_KEY_HPP__
+
+#include <type_traits>
+
+#include "hl_vulkan.hpp"
+
+namespace HLVulkan {
+
+    // Canonical byte serialization of Vulkan create-state, used to deduplicate objects created from identical descriptions. Fields are appended one
+    // by one (never whole structs) so padding never leaks into the key. Structures carrying a pNext chain can't be described and invalidate the key.
+    class StateKey {
+
+      public:
+        template <class T> StateKey &add(const T &value) {
+            static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value, "only scalar fields can be added");
+            bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));
+            return *this;
+        }
+
+        StateKey &add(const std::string &value);
+        StateKey &add(const VkVertexInputBindingDescription &binding);
+        StateKey &add(const VkVertexInputAttributeDescription &attribute);
+        StateKey &add(const VkPipelineInputAssemblyStateCreateInfo &inputAssembly);
+        StateKey &add(const VkViewport &viewport);
+        StateKey &add(const VkRect2D &scissor);
+        StateKey &add(const VkPipelineRasterizationStateCreateInfo &rasterizer);
+        StateKey &add(const VkPipelineMultisampleStateCreateInfo &multisampling);
+        StateKey &add(const VkPipelineColorBlendAttachmentState &colorBlendAttachment);
+        StateKey &add(const VkStencilOpState &stencilOp);
+        StateKey &add(const VkPipelineDepthStencilStateCreateInfo &depthStencil);
+        StateKey &add(const VkDescriptorSetLayoutBinding &binding);
+        StateKey &add(const VkAttachmentDescription &attachment);
+        StateKey &add(const VkAttachmentReference &reference);
+        StateKey &add(const VkSubpassDescription &subpass);
+        StateKey &add(const VkSubpassDependency &dependency);
+        StateKey &add(const StateKey &key);
+
+        template <class T> StateKey &add(const std::vector<T> &values) {
+            add(static_cast<uint32_t>(values.size()));
+            for (const T &value : values) {
+                add(value);
+            }
+            return *this;
+        }
+
+        bool isValid() const;
+        size_t hash() const;
+
+        bool operator==(const StateKey &other) const;
+
+      private:
+        std::string bytes;
+        bool valid = true;
+
+        void addNext(const void *pNext);
+
+        // Count followed by the elements of a C array
+        template <class T> void addArray(uint32_t count, const T *values) {
+            add(count);
+            for (uint32_t i = 0; i < count; i++) {
+                add(values[i]);
+            }
+        }
+    };
+
+    struct StateKeyHasher {
+        size_t operator()(const StateKey &key) const { return key.hash(); }
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_STATE_KEY_HPP__
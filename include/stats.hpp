@@ -0,0 +1,99 @@
+#ifndef __HL_VULKAN_STATS_HPP__
+#define __HL_VULKAN_STATS_HPP__
+
+#ifdef HL_VULKAN_ENABLE_STATS
+
+#include <chrono>
+#include <cstdint>
+
+namespace HLVulkan {
+
+    // Counters of driver calls and bytes moved by the library, and histograms of the time the CPU waits for the GPU. Every thread updates
+    // its own block of relaxed atomics, registered once per thread, so recording never takes a lock. snapshot() sums the blocks of every
+    // thread, past and present. Compiled in with HLVULKAN_ENABLE_STATS (which defines HL_VULKAN_ENABLE_STATS), otherwise the
+    // HL_VULKAN_STATS_* macros expand to nothing. Thread safe.
+    class Stats {
+
+      public:
+        enum Counter : uint32_t {
+            ALLOCATE_MEMORY_CALLS,
+            QUEUE_SUBMIT_CALLS,
+            QUEUE_WAIT_IDLE_CALLS,
+            MAPPED_BYTES,       // Buffer::mapAndCopy()
+            BUFFER_COPY_BYTES,  // Buffer::copyTo()
+            IMAGE_UPLOAD_BYTES, // Image::copyFromBuffer(), copied levels
+            COUNTER_COUNT
+        };
+
+        enum Histogram : uint32_t {
+            SINGLE_TIME_WAIT, // CommandPool::endSingleTimeCommands()
+            FENCE_WAIT,       // Fence::wait()
+            HISTOGRAM_COUNT
+        };
+
+        // Bucket i counts durations in [2^i, 2^(i+1)) ns, the last one everything longer
+        static const uint32_t BUCKET_COUNT = 40;
+
+        struct HistogramSnapshot {
+            uint64_t count = 0;
+            uint64_t totalNs = 0;
+            uint64_t maxNs = 0;
+            uint64_t buckets[BUCKET_COUNT] = {};
+
+            // Upper bound of the bucket holding the given fraction (0 to 1) of the durations
+            uint64_t percentile(double fraction) const;
+        };
+
+        struct Snapshot {
+            uint64_t counters[COUNTER_COUNT] = {};
+            HistogramSnapshot histograms[HISTOGRAM_COUNT];
+        };
+
+        static void add(Counter counter, uint64_t value = 1);
+
+        static void record(Histogram histogram, uint64_t nanoseconds);
+
+        static Snapshot snapshot();
+
+        // Values recorded concurrently with a reset may survive it
+        static void reset();
+
+        static const char *getName(Counter counter);
+        static const char *getName(Histogram histogram);
+
+        // Records its lifetime
+        class ScopedTimer {
+
+          public:
+            explicit ScopedTimer(Histogram histogram) : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+
+            ScopedTimer(const ScopedTimer &) = delete;
+            ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+            ~ScopedTimer() {
+                auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+                record(histogram, static_cast<uint64_t>(elapsed.count()));
+            }
+
+          private:
+            const Histogram histogram;
+            const std::chrono::steady_clock::time_point start;
+        };
+    };
+
+} // namespace HLVulkan
+
+#define HL_VULKAN_STATS_CONCAT_(a, b) a##b
+#define HL_VULKAN_STATS_CONCAT(a, b) HL_VULKAN_STATS_CONCAT_(a, b)
+
+#define HL_VULKAN_STATS_ADD(counter, value) HLVulkan::Stats::add(HLVulkan::Stats::counter, (value))
+#define HL_VULKAN_STATS_TIME(histogram) HLVulkan::Stats::ScopedTimer HL_VULKAN_STATS_CONCAT(statsTimer, __LINE__)(HLVulkan::Stats::histogram)
+
+#else
+
+#define HL_VULKAN_STATS_ADD(counter, value)
+#define HL_VULKAN_STATS_TIME(histogram)
+
+#endif // HL_VULKAN_ENABLE_STATS
+
+#endif //__HL_VULKAN_STATS_HPP__
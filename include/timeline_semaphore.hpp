@@ -0,0 +1,99 @@
+#ifndef __HL_VULKAN_TIMELINE_SEMAPHORE_HPP__
+#define __HL_VULKAN_TIMELINE_SEMAPHORE_HPP__
+
+#include <mutex>
+
+#include "device.hpp"
+#include "hl_vulkan.hpp"
+#include "queue.hpp"
+
+namespace HLVulkan {
+
+    // A value of a timeline semaphore. For binary semaphores the value is ignored.
+    struct TimelinePoint {
+        VkSemaphore semaphore;
+        uint64_t value;
+    };
+
+    // Waited by a submission before the stages run
+    struct TimelineWait {
+        VkSemaphore semaphore;
+        uint64_t value;
+        VkPipelineStageFlags stages;
+    };
+
+    // Submits the command buffers once every wait is satisfied, then signals the points (and the fence, if any). Binary and timeline semaphores
+    // can be mixed. The caller holds the mutex of the queue.
+    VkResult queueSubmit(VkQueue queue, const std::vector<VkCommandBuffer> &commandBuffers, const std::vector<TimelineWait> &waits,
+                         const std::vector<TimelinePoint> &signals, VkFence fence = VK_NULL_HANDLE);
+
+    // Semaphore holding a monotonically increasing 64 bit value, signaled and waited for from both the host and queues. Needs a Vulkan 1.2 device
+    // with the timelineSemaphore feature enabled (see DeviceCapabilities::supportsTimelineSemaphores()), the core entry points are called.
+    class TimelineSemaphore {
+
+      public:
+        TimelineSemaphore(Device device, uint64_t initialValue = 0);
+
+        TimelineSemaphore(const TimelineSemaphore &) = delete;
+        TimelineSemaphore &operator=(const TimelineSemaphore &) = delete;
+
+        VkSemaphore getSemaphore() const;
+
+        // Host signal, the value must be greater than the current one and than any pending signal
+        VkResult signal(uint64_t value);
+
+        // VK_TIMEOUT if the value wasn't reached in time
+        VkResult wait(uint64_t value, uint64_t timeout = UINT64_MAX) const;
+
+        VkResult getValue(uint64_t &value) const;
+
+        bool isReached(uint64_t value) const;
+
+        // Waits for every point to be reached, or for any of them
+        static VkResult waitMany(VkDevice device, const std::vector<TimelinePoint> &points, bool any = false, uint64_t timeout = UINT64_MAX);
+
+        ~TimelineSemaphore();
+
+      private:
+        const Device device;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+    };
+
+    // One timeline semaphore per queue, signaled with the next value of a counter by every submission. Waiting for a submission, on the host or
+    // from another queue, only takes the value submit() returned, which replaces a fence per submission. The counter is guarded by the mutex of the
+    // queue, shared with every other user of the queue (see Queue). Thread safe.
+    class QueueTimeline {
+
+      public:
+        QueueTimeline(Device device, Queue queue);
+
+        QueueTimeline(const QueueTimeline &) = delete;
+        QueueTimeline &operator=(const QueueTimeline &) = delete;
+
+        // Submits after the waits and signals the next value (plus the extra signals), returned in value
+        VkResult submit(const std::vector<VkCommandBuffer> &commandBuffers, const std::vector<TimelineWait> &waits, uint64_t &value,
+                        const std::vector<TimelinePoint> &signals = {});
+
+        // Point of the last submission, to be waited for by another queue
+        TimelinePoint getLastSubmitted() const;
+
+        VkResult wait(uint64_t value, uint64_t timeout = UINT64_MAX) const;
+
+        bool isComplete(uint64_t value) const;
+
+        TimelineSemaphore &getSemaphore();
+
+        // Mutex of the queue, held by submit() while it uses the queue
+        std::mutex &getQueueMutex() const;
+
+      private:
+        const Queue queue;
+        TimelineSemaphore semaphore;
+
+        // Values must be submitted in increasing order, so the counter is guarded by the queue mutex
+        uint64_t lastValue = 0;
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_TIMELINE_SEMAPHORE_HPP__
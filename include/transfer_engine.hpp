@@ -0,0 +1,103 @@
+#ifndef __HL_VULKAN_TRANSFER_ENGINE_HPP__
+#define __HL_VULKAN_TRANSFER_ENGINE_HPP__
+
+#include <memory>
+
+#include "barrier_batch.hpp"
+#include "buffer.hpp"
+#include "command_pool.hpp"
+#include "device.hpp"
+#include "hl_vulkan.hpp"
+#include "image.hpp"
+#include "queue.hpp"
+
+namespace HLVulkan {
+
+    struct TransferBatch;
+
+    // Waitable handle on a submitted batch of transfers. A default constructed ticket is already complete. Tickets can be polled and waited on
+    // from any thread, concurrently with the engine recycling the batch.
+    class TransferTicket {
+
+      public:
+        TransferTicket() = default;
+
+        bool isComplete() const;
+
+        VkResult wait(uint64_t timeout = UINT64_MAX) const;
+
+      private:
+        friend class TransferEngine;
+
+        std::shared_ptr<TransferBatch> batch;
+
+        explicit TransferTicket(std::shared_ptr<TransferBatch> batch);
+    };
+
+    // Records copy and layout transition requests into a shared command buffer and submits them together with a fence, instead of one submission
+    // and one vkQueueWaitIdle per operation. Resources used by a batch must stay alive until its ticket completes, see keepAlive(). On a queue of
+    // a dedicated transfer family (DeviceCapabilities::findTransferQueueFamily()) uploads overlap rendering, the uploaded resources are then
+    // handed over with release(). Not thread safe, apart from the tickets it returns.
+    class TransferEngine {
+
+      public:
+        TransferEngine(Device device, Queue queue);
+
+        TransferEngine(const TransferEngine &) = delete;
+        TransferEngine &operator=(const TransferEngine &) = delete;
+
+        VkResult copyBuffer(Buffer &srcBuffer, Buffer &dstBuffer);
+
+        VkResult copyBufferToImage(Buffer &srcBuffer, Image &dstImage, VkImageLayout layout);
+
+        // Precomputed mip levels, see Image::recordCopyFromBuffer()
+        VkResult copyBufferToImage(Buffer &srcBuffer, Image &dstImage, VkImageLayout layout, const std::vector<VkDeviceSize> &levelOffsets);
+
+        VkResult transitionImageLayout(Image &image, VkImageLayout oldLayout, VkImageLayout newLayout);
+
+        // Tracked transitions, gathered into a single barrier recorded before the next copy or submission. Copies expect their resources to
+        // be transitioned for them already, and record their own access in the tracked state.
+        VkResult transition(Buffer &buffer, const ResourceAccess &access);
+        VkResult transition(Image &image, const ResourceAccess &access);
+
+        // Hands an uploaded EXCLUSIVE resource over to dstFamily, which will use it with the access. The release makes the last tracked write
+        // available, e.g. the transfer write of a copy recorded by this engine. The receiving queue must wait for a semaphore signaled by
+        // submit() and record the matching BarrierBatch::acquire() before using the resource.
+        VkResult release(Buffer &buffer, uint32_t dstFamily, const ResourceAccess &access);
+        VkResult release(Image &image, uint32_t dstFamily, const ResourceAccess &access);
+
+        // Ties the lifetime of an object (typically a staging buffer) to the completion of the pending batch
+        void keepAlive(std::shared_ptr<void> resource);
+
+        // Submits the pending requests and returns immediately, the semaphores are signaled once they complete
+        VkResult submit(TransferTicket &ticket, const std::vector<VkSemaphore> &signalSemaphores = {});
+
+        // Explicit blocking opt-in: submits the pending requests and waits for their completion
+        VkResult submitAndWait();
+
+        // Recycles the command buffers and fences of completed batches, returns the number of batches still in flight
+        size_t collect();
+
+        size_t getPendingCount() const;
+
+        uint32_t getQueueFamily() const;
+
+        virtual ~TransferEngine();
+
+      private:
+        const Device device;
+        const Queue queue;
+
+        CommandPool commandPool;
+        std::shared_ptr<TransferBatch> pending;
+        std::vector<std::shared_ptr<TransferBatch>> inFlight;
+        std::vector<VkFence> freeFences;
+        BarrierBatch barriers;
+
+        VkResult beginBatch();
+        void flushBarriers();
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_TRANSFER_ENGINE_HPP__
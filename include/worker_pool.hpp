@@ -0,0 +1,57 @@
+#ifndef __HL_VULKAN_WORKER_POOL_HPP__
+#define __HL_VULKAN_WORKER_POOL_HPP__
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+
+#include "hl_vulkan.hpp"
+
+namespace HLVulkan {
+
+    // Fixed set of threads running submitted tasks in FIFO order. Tasks still queued on destruction are run before the threads are joined, so
+    // no future is ever left broken.
+    class WorkerPool {
+
+      public:
+        // 0 uses one thread per hardware thread
+        explicit WorkerPool(size_t threadCount = 0);
+
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        template <class Function> std::future<std::invoke_result_t<Function>> submit(Function function) {
+            using Result = std::invoke_result_t<Function>;
+
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+            std::future<Result> future = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace([task]() { (*task)(); });
+            }
+            condition.notify_one();
+            return future;
+        }
+
+        size_t getThreadCount() const;
+
+        virtual ~WorkerPool();
+
+      private:
+        std::vector<std::thread> threads;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+
+        void run();
+    };
+
+} // namespace HLVulkan
+
+#endif //__HL_VULKAN_WORKER_POOL_HPP__
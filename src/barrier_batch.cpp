@@ -0,0 +1,232 @@
+#include "barrier_batch.hpp"
+
+#include <algorithm>
+
+namespace HLVulkan {
+
+    // The destination scope of a release is ignored, the acquire has it
+    VkPipelineStageFlags BarrierBatch::getDstStages(const PendingBarrier &pending) {
+        return pending.ownership == Ownership::RELEASE ? 0 : pending.access.stages;
+    }
+
+    VkAccessFlags BarrierBatch::getDstAccess(const PendingBarrier &pending) { return pending.ownership == Ownership::RELEASE ? 0 : pending.access.access; }
+
+    void BarrierBatch::update(PendingBarrier &pending, ResourceState &state, const ResourceAccess &access, bool trackLayout, bool first) {
+
+        // A second transition in the same batch replaces the first one, so start over from the state the batch found
+        if (first) {
+            pending.previous = state;
+        } else {
+            state = pending.previous;
+        }
+
+        pending.oldLayout = state.layout;
+        pending.access = access;
+        pending.needed = state.transition(access, trackLayout, pending.srcStages, pending.srcAccess);
+        pending.ownership = Ownership::KEEP;
+        pending.srcFamily = VK_QUEUE_FAMILY_IGNORED;
+        pending.dstFamily = VK_QUEUE_FAMILY_IGNORED;
+    }
+
+    void BarrierBatch::updateOwnership(PendingBarrier &pending, ResourceState &state, const ResourceAccess &access, bool trackLayout, bool first,
+                                       Ownership ownership, uint32_t srcFamily, uint32_t dstFamily) {
+
+        if (first) {
+            pending.previous = state;
+        } else {
+            state = pending.previous;
+        }
+
+        // Both halves carry the same layout transition. The release makes the writes available, the acquire makes them visible to the access,
+        // so the state is updated as if the access happened at the release.
+        pending.access = access;
+        pending.needed = true;
+        pending.ownership = ownership;
+        pending.srcFamily = srcFamily;
+        pending.dstFamily = dstFamily;
+        if (ownership == Ownership::RELEASE) {
+            pending.oldLayout = state.layout;
+            state.transition(access, trackLayout, pending.srcStages, pending.srcAccess);
+            state.released = true;
+            state.releasedLayout = pending.oldLayout;
+        } else {
+            ASSERT_MSG(state.released, "acquire without a matching release");
+            pending.oldLayout = state.releasedLayout;
+            pending.srcStages = 0;
+            pending.srcAccess = 0;
+            state.released = false;
+        }
+    }
+
+    void BarrierBatch::transition(Buffer &buffer, const ResourceAccess &access) {
+        auto inserted = bufferBarriers.emplace(buffer.getBuffer(), PendingBarrier{});
+        update(inserted.first->second, buffer.state, access, false, inserted.second);
+    }
+
+    void BarrierBatch::transition(Image &image, const ResourceAccess &access, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer,
+                                  uint32_t layerCount) {
+
+        ASSERT_MSG(access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != VK_IMAGE_LAYOUT_PREINITIALIZED, "invalid image layout transition");
+        ASSERT_MSG(baseMipLevel < image.mipLevels && baseArrayLayer < image.arrayLayers, "subresource out of range");
+
+        uint32_t endMipLevel = levelCount == VK_REMAINING_MIP_LEVELS ? image.mipLevels : std::min(image.mipLevels, baseMipLevel + levelCount);
+        uint32_t endArrayLayer = layerCount == VK_REMAINING_ARRAY_LAYERS ? image.arrayLayers : std::min(image.arrayLayers, baseArrayLayer + layerCount);
+
+        imageAspects[image.image] = image.getBarrierAspect();
+        for (uint32_t mipLevel = baseMipLevel; mipLevel < endMipLevel; mipLevel++) {
+            for (uint32_t arrayLayer = baseArrayLayer; arrayLayer < endArrayLayer; arrayLayer++) {
+                auto inserted = imageBarriers.emplace(std::make_tuple(image.image, mipLevel, arrayLayer), PendingBarrier{});
+                update(inserted.first->second, image.getSubresourceState(mipLevel, arrayLayer), access, true, inserted.second);
+            }
+        }
+    }
+
+    void BarrierBatch::transferOwnership(Buffer &buffer, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access, Ownership ownership) {
+        if (buffer.isConcurrent() || srcFamily == dstFamily) {
+            if (ownership == Ownership::ACQUIRE) {
+                transition(buffer, access);
+            }
+            return;
+        }
+
+        auto inserted = bufferBarriers.emplace(buffer.getBuffer(), PendingBarrier{});
+        updateOwnership(inserted.first->second, buffer.state, access, false, inserted.second, ownership, srcFamily, dstFamily);
+    }
+
+    void BarrierBatch::transferOwnership(Image &image, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access, Ownership ownership) {
+        if (image.isConcurrent() || srcFamily == dstFamily) {
+            if (ownership == Ownership::ACQUIRE) {
+                transition(image, access);
+            }
+            return;
+        }
+
+        ASSERT_MSG(access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != VK_IMAGE_LAYOUT_PREINITIALIZED, "invalid image layout transition");
+        imageAspects[image.image] = image.getBarrierAspect();
+        for (uint32_t mipLevel = 0; mipLevel < image.mipLevels; mipLevel++) {
+            for (uint32_t arrayLayer = 0; arrayLayer < image.arrayLayers; arrayLayer++) {
+                auto inserted = imageBarriers.emplace(std::make_tuple(image.image, mipLevel, arrayLayer), PendingBarrier{});
+                updateOwnership(inserted.first->second, image.getSubresourceState(mipLevel, arrayLayer), access, true, inserted.second, ownership,
+                                srcFamily, dstFamily);
+            }
+        }
+    }
+
+    void BarrierBatch::release(Buffer &buffer, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access) {
+        transferOwnership(buffer, srcFamily, dstFamily, access, Ownership::RELEASE);
+    }
+
+    void BarrierBatch::acquire(Buffer &buffer, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access) {
+        transferOwnership(buffer, srcFamily, dstFamily, access, Ownership::ACQUIRE);
+    }
+
+    void BarrierBatch::release(Image &image, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access) {
+        transferOwnership(image, srcFamily, dstFamily, access, Ownership::RELEASE);
+    }
+
+    void BarrierBatch::acquire(Image &image, uint32_t srcFamily, uint32_t dstFamily, const ResourceAccess &access) {
+        transferOwnership(image, srcFamily, dstFamily, access, Ownership::ACQUIRE);
+    }
+
+    bool BarrierBatch::empty() const { return bufferBarriers.empty() && imageBarriers.empty(); }
+
+    void BarrierBatch::record(VkCommandBuffer commandBuffer) {
+
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+
+        std::vector<VkBufferMemoryBarrier> buffers;
+        for (const auto &entry : bufferBarriers) {
+            const PendingBarrier &pending = entry.second;
+            if (!pending.needed) {
+                continue;
+            }
+            srcStages |= pending.srcStages;
+            dstStages |= getDstStages(pending);
+
+            VkBufferMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = pending.srcAccess;
+            barrier.dstAccessMask = getDstAccess(pending);
+            barrier.srcQueueFamilyIndex = pending.srcFamily;
+            barrier.dstQueueFamilyIndex = pending.dstFamily;
+            barrier.buffer = entry.first;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            buffers.push_back(barrier);
+        }
+
+        // Subresources come sorted by image, mip level and array layer: consecutive layers of a level are merged first, then consecutive levels
+        // covering the same layers
+        std::vector<VkImageMemoryBarrier> images;
+        auto mergeable = [](const VkImageMemoryBarrier &a, const VkImageMemoryBarrier &b) {
+            return a.image == b.image && a.oldLayout == b.oldLayout && a.newLayout == b.newLayout && a.srcAccessMask == b.srcAccessMask &&
+                   a.dstAccessMask == b.dstAccessMask && a.srcQueueFamilyIndex == b.srcQueueFamilyIndex && a.dstQueueFamilyIndex == b.dstQueueFamilyIndex;
+        };
+        for (const auto &entry : imageBarriers) {
+            const PendingBarrier &pending = entry.second;
+            if (!pending.needed) {
+                continue;
+            }
+            srcStages |= pending.srcStages;
+            dstStages |= getDstStages(pending);
+
+            VkImageMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = pending.srcAccess;
+            barrier.dstAccessMask = getDstAccess(pending);
+            barrier.oldLayout = pending.oldLayout;
+            barrier.newLayout = pending.access.layout;
+            barrier.srcQueueFamilyIndex = pending.srcFamily;
+            barrier.dstQueueFamilyIndex = pending.dstFamily;
+            barrier.image = std::get<0>(entry.first);
+            barrier.subresourceRange.aspectMask = imageAspects.at(barrier.image);
+            barrier.subresourceRange.baseMipLevel = std::get<1>(entry.first);
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.baseArrayLayer = std::get<2>(entry.first);
+            barrier.subresourceRange.layerCount = 1;
+
+            if (!images.empty()) {
+                VkImageSubresourceRange &last = images.back().subresourceRange;
+                if (mergeable(images.back(), barrier) && last.baseMipLevel == barrier.subresourceRange.baseMipLevel &&
+                    last.baseArrayLayer + last.layerCount == barrier.subresourceRange.baseArrayLayer) {
+                    last.layerCount++;
+                    continue;
+                }
+            }
+            images.push_back(barrier);
+        }
+
+        std::vector<VkImageMemoryBarrier> mergedImages;
+        for (const VkImageMemoryBarrier &barrier : images) {
+            if (!mergedImages.empty()) {
+                VkImageSubresourceRange &last = mergedImages.back().subresourceRange;
+                if (mergeable(mergedImages.back(), barrier) && last.baseArrayLayer == barrier.subresourceRange.baseArrayLayer &&
+                    last.layerCount == barrier.subresourceRange.layerCount && last.baseMipLevel + last.levelCount == barrier.subresourceRange.baseMipLevel) {
+                    last.levelCount++;
+                    continue;
+                }
+            }
+            mergedImages.push_back(barrier);
+        }
+
+        bufferBarriers.clear();
+        imageBarriers.clear();
+        imageAspects.clear();
+
+        if (buffers.empty() && mergedImages.empty()) {
+            return;
+        }
+
+        // Nothing to wait for (first use of a resource) still needs a valid stage mask
+        if (srcStages == 0) {
+            srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        }
+        if (dstStages == 0) {
+            dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        }
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, static_cast<uint32_t>(buffers.size()), buffers.data(),
+                             static_cast<uint32_t>(mergedImages.size()), mergedImages.data());
+    }
+
+} // namespace HLVulkan
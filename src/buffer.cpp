@@ -2,93 +2,138 @@
 
 #include <string.h>
 
+#include "stats.hpp"
+
 namespace HLVulkan {
 
-    VkResult Buffer::createBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer) {
+    VkResult Buffer::createBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer,
+                                  const std::vector<uint32_t> &queueFamilies) {
 
         VkBufferCreateInfo bufferInfo = {};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
         bufferInfo.usage = usage;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        bufferInfo.sharingMode = queueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+        if (bufferInfo.sharingMode == VK_SHARING_MODE_CONCURRENT) {
+            bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+            bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+        }
 
         return vkCreateBuffer(device, &bufferInfo, nullptr, &buffer);
     }
 
-    Buffer::Buffer(Device device, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) : device(device), usage(usage), memProperties(properties) {}
+    Buffer::Buffer(Device device, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const std::vector<uint32_t> &queueFamilies)
+        : device(device), usage(usage), memProperties(properties), queueFamilies(getDistinctQueueFamilies(queueFamilies)) {}
 
-    Buffer::Buffer(Device device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
-        : device(device), size(size), usage(usage), memProperties(properties) {
-        VK_CHECK_FAIL(createBuffer(device.logical, size, usage, buffer), "buffer creation failed");
+    Buffer::Buffer(Device device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool persistentMap,
+                   const std::vector<uint32_t> &queueFamilies)
+        : device(device), size(size), usage(usage), memProperties(properties), persistentMap(persistentMap),
+          queueFamilies(getDistinctQueueFamilies(queueFamilies)) {
+        VK_CHECK_FAIL(createBuffer(device.logical, size, usage, buffer, this->queueFamilies), "buffer creation failed");
         VK_CHECK_FAIL(bind(), "buffer bind failed");
     }
 
     VkResult Buffer::allocateBuffer(VkDeviceSize size) {
         VK_CHECK_NULL(buffer);
-        VK_CHECK_RET(createBuffer(device.logical, size, usage, buffer));
+        this->size = size;
+        VK_CHECK_RET(createBuffer(device.logical, size, usage, buffer, queueFamilies));
         return bind();
     }
 
     VkResult Buffer::bind() {
 
-        VK_CHECK_NULL(memory);
+        VK_CHECK_NULL(allocation.memory);
 
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(device.logical, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        std::optional memType = device.findMemoryType(memRequirements.memoryTypeBits, memProperties);
-        if (memType) {
-            allocInfo.memoryTypeIndex = *memType;
-        } else {
-            return VK_ERROR_FEATURE_NOT_PRESENT;
-        }
+        VK_CHECK_RET(device.getAllocator().allocate(memRequirements, memProperties, MemoryAllocator::ResourceType::LINEAR, allocation));
+        VK_CHECK_RET(vkBindBufferMemory(device.logical, buffer, allocation.memory, allocation.offset));
 
-        VK_CHECK_RET(vkAllocateMemory(device.logical, &allocInfo, nullptr, &memory));
-        return vkBindBufferMemory(device.logical, buffer, memory, 0);
+        if (persistentMap) {
+            ASSERT_MSG(memProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, "memory is not mappable");
+            return device.getAllocator().map(allocation, &mapped);
+        }
+        return VK_SUCCESS;
     }
 
-    VkResult Buffer::mapAndCopy(const void *dataToCopy, size_t size) {
+    VkResult Buffer::mapAndCopy(const void *dataToCopy, size_t size, VkDeviceSize offset) {
 
-        VK_CHECK_NOT_NULL(memory);
+        VK_CHECK_NOT_NULL(allocation.memory);
         ASSERT_MSG(memProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, "memory is not mappable");
+        ASSERT_MSG(offset + size <= this->size, "copy goes past the end of the buffer");
+        HL_VULKAN_STATS_ADD(MAPPED_BYTES, size);
+
+        // Persistently mapped buffers only need the copy (and a flush on non-coherent memory)
+        if (mapped) {
+            memcpy(static_cast<char *>(mapped) + offset, dataToCopy, size);
+            return flush(offset, size);
+        }
 
         void *data;
-        VK_CHECK_RET(vkMapMemory(device.logical, memory, 0, size, 0, &data));
-        memcpy(data, dataToCopy, size);
-        vkUnmapMemory(device.logical, memory);
+        VK_CHECK_RET(device.getAllocator().map(allocation, &data));
+        memcpy(static_cast<char *>(data) + offset, dataToCopy, size);
+        VkResult ret = flush(offset, size);
+        device.getAllocator().unmap(allocation);
 
-        return VK_SUCCESS;
+        return ret;
     }
 
-    VkResult Buffer::copyTo(const Buffer &dstBuffer, CommandPool &commandPool) {
+    VkResult Buffer::flush(VkDeviceSize offset, VkDeviceSize size) { return device.getAllocator().flush(allocation, offset, size); }
+
+    VkResult Buffer::copyTo(Buffer &dstBuffer, CommandPool &commandPool) {
+
+        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands("Buffer::copyTo");
+        VK_CHECK_NOT_NULL(commandBuffer);
+
+        recordCopyTo(commandBuffer, dstBuffer);
+        HL_VULKAN_STATS_ADD(BUFFER_COPY_BYTES, size);
+
+        return commandPool.endSingleTimeCommands(commandBuffer);
+    }
+
+    void Buffer::recordCopyTo(VkCommandBuffer commandBuffer, Buffer &dstBuffer) {
 
         // @TODO: buffers must be bind to memory ?
         ASSERT_MSG(size <= dstBuffer.size, "destination buffer is bigger than source buffer");
         ASSERT_MSG((usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) != 0, "source buffer doesn't have required usage flag");
         ASSERT_MSG((dstBuffer.usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) != 0, "destination buffer doesn't have required usage flag");
 
-        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands();
-        VK_CHECK_NOT_NULL(commandBuffer);
-
         VkBufferCopy copyRegion = {};
         copyRegion.size = size;
         vkCmdCopyBuffer(commandBuffer, buffer, dstBuffer.buffer, 1, &copyRegion);
 
-        return commandPool.endSingleTimeCommands(commandBuffer);
+        state.record({VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT}, false);
+        dstBuffer.state.record({VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT}, false);
     }
 
     VkBufferUsageFlags Buffer::getUsageFlags() { return usage; }
 
     VkBuffer Buffer::getBuffer() { return buffer; }
 
+    VkDeviceSize Buffer::getSize() const { return size; }
+
+    bool Buffer::isConcurrent() const { return queueFamilies.size() > 1; }
+
+    VkMemoryPropertyFlags Buffer::getMemoryProperties() const { return memProperties; }
+
+    bool Buffer::isPersistentlyMapped() const { return persistentMap; }
+
+    void *Buffer::getMappedData() const { return mapped; }
+
+    bool Buffer::isCoherent() const {
+        VK_CHECK_NOT_NULL(allocation.memory);
+        return (device.getAllocator().getMemoryTypeProperties(allocation.memoryType) & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    }
+
+    const MemoryAllocation &Buffer::getAllocation() const { return allocation; }
+
     Buffer::~Buffer() {
-        vkDestroyBuffer(device.logical, buffer, nullptr);
-        if (memory) {
-            vkFreeMemory(device.logical, memory, nullptr);
+        if (mapped) {
+            device.getAllocator().unmap(allocation);
         }
+        vkDestroyBuffer(device.logical, buffer, nullptr);
+        device.getAllocator().free(allocation);
     }
 
 } // namespace HLVulkan
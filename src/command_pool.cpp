@@ -1,74 +1,140 @@
 #include "command_pool.hpp"
 
-namespace HLVulkan {
-
-    CommandPool::CommandPool(Device device, Queue queue) : device(device), queue(queue) {
+#include <algorithm>
 
-        VkCommandPoolCreateInfo poolInfo = {};
-        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        poolInfo.queueFamilyIndex = queue.family;
+#include "gpu_profiler.hpp"
+#include "stats.hpp"
 
-        VK_CHECK_FAIL(vkCreateCommandPool(device.logical, &poolInfo, nullptr, &pool), "command pool creation failed");
-    }
+namespace HLVulkan {
 
-    CommandPool::CommandPool(Device device, Queue queue, uint32_t count) : device(device), queue(queue) {
+    CommandPool::CommandPool(Device device, Queue queue, uint32_t count, VkCommandPoolCreateFlags flags) : device(device), queue(queue), flags(flags) {
 
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = flags;
         poolInfo.queueFamilyIndex = queue.family;
 
         VK_CHECK_FAIL(vkCreateCommandPool(device.logical, &poolInfo, nullptr, &pool), "command pool creation failed");
-        VK_CHECK_FAIL(allocateCommandBuffers(count), "failed to allocate command buffers");
+        if (count != 0) {
+            VK_CHECK_FAIL(allocateCommandBuffers(count), "failed to allocate command buffers");
+        }
     }
 
     VkResult CommandPool::allocateCommandBuffers(uint32_t count) {
 
         ASSERT_MSG(count != 0, "count must be strictly positive");
-        ASSERT_MSG(commandBuffers.empty(), "allocate should only be called once per command pool"); // @TODO: this is a hardcore limitation
 
-        // Resize the vector
-        commandBuffers.resize((size_t)count);
+        // Grow the vector
+        size_t first = commandBuffers.size();
+        commandBuffers.resize(first + count);
 
         VkCommandBufferAllocateInfo allocInfo = {};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.commandPool = pool;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
+        allocInfo.commandBufferCount = count;
 
+        allocationCount++;
         VkResult ret;
-        if ((ret = vkAllocateCommandBuffers(device.logical, &allocInfo, commandBuffers.data())) != VK_SUCCESS) {
-            // Resize the vector to 0 if the allocation fails
-            commandBuffers.resize(0);
+        if ((ret = vkAllocateCommandBuffers(device.logical, &allocInfo, commandBuffers.data() + first)) != VK_SUCCESS) {
+            // Shrink the vector back if the allocation fails
+            commandBuffers.resize(first);
         }
         return ret;
     }
 
-    VkCommandBuffer CommandPool::beginSingleTimeCommands() {
+    VkCommandBuffer CommandPool::acquireCommandBuffer(VkCommandBufferLevel level) {
 
-        VkCommandBufferAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = pool;
-        allocInfo.commandBufferCount = 1;
+        ASSERT_MSG(level == VK_COMMAND_BUFFER_LEVEL_PRIMARY || level == VK_COMMAND_BUFFER_LEVEL_SECONDARY, "invalid command buffer level");
+        std::vector<VkCommandBuffer> &freeList = freeCommandBuffers[level];
 
         VkCommandBuffer commandBuffer;
-        VK_CHECK_RET_NULL(vkAllocateCommandBuffers(device.logical, &allocInfo, &commandBuffer));
+        if (freeList.empty()) {
+            VkCommandBufferAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = level;
+            allocInfo.commandPool = pool;
+            allocInfo.commandBufferCount = 1;
+
+            allocationCount++;
+            VK_CHECK_RET_NULL(vkAllocateCommandBuffers(device.logical, &allocInfo, &commandBuffer));
+        } else {
+            commandBuffer = freeList.back();
+            freeList.pop_back();
+        }
+
+        acquiredCommandBuffers[level].push_back(commandBuffer);
+        return commandBuffer;
+    }
+
+    void CommandPool::release(VkCommandBuffer commandBuffer) {
+
+        for (size_t level = 0; level < LEVEL_COUNT; level++) {
+            // Recently acquired buffers are the likeliest to be released
+            std::vector<VkCommandBuffer> &acquired = acquiredCommandBuffers[level];
+            auto it = std::find(acquired.rbegin(), acquired.rend(), commandBuffer);
+            if (it == acquired.rend()) {
+                continue;
+            }
+            acquired.erase(std::next(it).base());
+
+            // Without individual reset the buffer couldn't be recorded again before the next pool reset
+            if (flags & VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT) {
+                freeCommandBuffers[level].push_back(commandBuffer);
+            } else {
+                vkFreeCommandBuffers(device.logical, pool, 1, &commandBuffer);
+            }
+            return;
+        }
+        ASSERT_MSG(false, "command buffer wasn't acquired from this pool");
+    }
+
+    VkResult CommandPool::reset(VkCommandPoolResetFlags resetFlags) {
+        VK_CHECK_RET(vkResetCommandPool(device.logical, pool, resetFlags));
+        for (size_t level = 0; level < LEVEL_COUNT; level++) {
+            freeCommandBuffers[level].insert(freeCommandBuffers[level].end(), acquiredCommandBuffers[level].begin(), acquiredCommandBuffers[level].end());
+            acquiredCommandBuffers[level].clear();
+        }
+        return VK_SUCCESS;
+    }
+
+    VkCommandBuffer CommandPool::beginSingleTimeCommands(const char *label) {
+
+        VkCommandBuffer commandBuffer = acquireCommandBuffer();
+        if (commandBuffer == VK_NULL_HANDLE) {
+            return VK_NULL_HANDLE;
+        }
 
         VkCommandBufferBeginInfo beginInfo = {};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-        VK_CHECK_RET_NULL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+        VkResult ret;
+        if ((ret = vkBeginCommandBuffer(commandBuffer, &beginInfo)) != VK_SUCCESS) {
+            release(commandBuffer);
+            VK_CHECK_RET_NULL(ret);
+        }
 
+        if (profiler && label) {
+            zones[commandBuffer] = profiler->beginZone(commandBuffer, label);
+        }
         return commandBuffer;
     }
 
     VkResult CommandPool::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
 
+        auto zone = zones.find(commandBuffer);
+        if (zone != zones.end()) {
+            if (profiler) {
+                profiler->endZone(commandBuffer, zone->second);
+            }
+            zones.erase(zone);
+        }
+
         // End recording
         VkResult ret;
         if ((ret = vkEndCommandBuffer(commandBuffer)) != VK_SUCCESS) {
-            vkFreeCommandBuffers(device.logical, pool, 1, &commandBuffer);
+            release(commandBuffer);
             return ret;
         }
 
@@ -77,18 +143,34 @@ namespace HLVulkan {
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        // Submit to the queue
-        if ((ret = vkQueueSubmit(queue.queue, 1, &submitInfo, VK_NULL_HANDLE)) != VK_SUCCESS) {
-            vkFreeCommandBuffers(device.logical, pool, 1, &commandBuffer);
-            return ret;
+        {
+            // Submit to the queue
+            std::lock_guard<std::mutex> lock(*queue.mutex);
+            HL_VULKAN_STATS_ADD(QUEUE_SUBMIT_CALLS, 1);
+            if ((ret = vkQueueSubmit(queue.queue, 1, &submitInfo, VK_NULL_HANDLE)) != VK_SUCCESS) {
+                release(commandBuffer);
+                return ret;
+            }
+
+            // Wait for the queue to idle, which also needs the queue to be synchronized
+            HL_VULKAN_STATS_ADD(QUEUE_WAIT_IDLE_CALLS, 1);
+            HL_VULKAN_STATS_TIME(SINGLE_TIME_WAIT);
+            ret = vkQueueWaitIdle(queue.queue);
         }
-
-        // Wait for the queue to idle
-        ret = vkQueueWaitIdle(queue.queue);
-        vkFreeCommandBuffers(device.logical, pool, 1, &commandBuffer);
+        release(commandBuffer);
         return ret;
     }
 
+    void CommandPool::abortSingleTimeCommands(VkCommandBuffer commandBuffer) {
+
+        // The zone is never ended, so the profiler never waits for it
+        zones.erase(commandBuffer);
+
+        // A recycled command buffer can't be begun again while it's still recording
+        vkEndCommandBuffer(commandBuffer);
+        release(commandBuffer);
+    }
+
     VkCommandBuffer CommandPool::getCommandBuffer(size_t index) {
         ASSERT_MSG(index < commandBuffers.size(), "invalid index");
         return commandBuffers[index];
@@ -96,6 +178,12 @@ namespace HLVulkan {
 
     VkCommandPool CommandPool::getPool() { return pool; }
 
+    size_t CommandPool::getAllocationCount() const { return allocationCount; }
+
+    void CommandPool::setProfiler(GpuProfiler *profiler) { this->profiler = profiler; }
+
+    GpuProfiler *CommandPool::getProfiler() const { return profiler; }
+
     CommandPool::~CommandPool() { vkDestroyCommandPool(device.logical, pool, nullptr); }
 
 } // namespace HLVulkan
@@ -0,0 +1,153 @@
+#include "descriptor_allocator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace HLVulkan {
+
+    const std::vector<DescriptorPoolRatio> DescriptorAllocator::DEFAULT_RATIOS = {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f}, {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f}, {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f}, {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f}, {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f}, {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f},
+    };
+
+    DescriptorAllocator::DescriptorAllocator(Device device, uint32_t setsPerPool, const std::vector<DescriptorPoolRatio> &ratios)
+        : device(device), ratios(ratios), setsPerPool(std::min(setsPerPool, MAX_SETS_PER_POOL)) {
+        ASSERT_MSG(setsPerPool != 0, "setsPerPool must be strictly positive");
+        ASSERT_MSG(!ratios.empty(), "no descriptor types");
+    }
+
+    VkResult DescriptorAllocator::nextPool() {
+
+        if (currentPool != VK_NULL_HANDLE) {
+            fullPools.push_back(currentPool);
+            currentPool = VK_NULL_HANDLE;
+        }
+
+        if (!freePools.empty()) {
+            currentPool = freePools.back();
+            freePools.pop_back();
+            return VK_SUCCESS;
+        }
+
+        std::vector<VkDescriptorPoolSize> poolSizes;
+        for (const DescriptorPoolRatio &ratio : ratios) {
+            poolSizes.push_back({ratio.type, std::max(1u, static_cast<uint32_t>(std::ceil(ratio.perSet * setsPerPool)))});
+        }
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = setsPerPool;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+
+        VK_CHECK_RET(vkCreateDescriptorPool(device.logical, &poolInfo, nullptr, &currentPool));
+        poolCount++;
+        setsPerPool = std::min(2 * setsPerPool, MAX_SETS_PER_POOL);
+        return VK_SUCCESS;
+    }
+
+    VkResult DescriptorAllocator::allocate(VkDescriptorSetLayout layout, VkDescriptorSet &set) {
+
+        if (currentPool == VK_NULL_HANDLE) {
+            VK_CHECK_RET(nextPool());
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = currentPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        VkResult ret = vkAllocateDescriptorSets(device.logical, &allocInfo, &set);
+        if (ret != VK_ERROR_OUT_OF_POOL_MEMORY && ret != VK_ERROR_FRAGMENTED_POOL) {
+            return ret;
+        }
+
+        // The pool is full, a set that doesn't fit a fresh one never will
+        VK_CHECK_RET(nextPool());
+        allocInfo.descriptorPool = currentPool;
+        return vkAllocateDescriptorSets(device.logical, &allocInfo, &set);
+    }
+
+    VkResult DescriptorAllocator::allocate(const std::vector<VkDescriptorSetLayoutBinding> &bindings, VkDescriptorSet &set) {
+        VkDescriptorSetLayout layout = device.getDescriptorLayoutCache().getLayout(bindings);
+        if (layout == VK_NULL_HANDLE) {
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+        return allocate(layout, set);
+    }
+
+    VkResult DescriptorAllocator::reset() {
+
+        if (currentPool != VK_NULL_HANDLE) {
+            fullPools.push_back(currentPool);
+            currentPool = VK_NULL_HANDLE;
+        }
+
+        VkResult ret = VK_SUCCESS;
+        for (VkDescriptorPool pool : fullPools) {
+            VkResult reset = vkResetDescriptorPool(device.logical, pool, 0);
+            if (reset != VK_SUCCESS) {
+                ret = reset;
+            }
+            freePools.push_back(pool);
+        }
+        fullPools.clear();
+        return ret;
+    }
+
+    size_t DescriptorAllocator::getPoolCount() const { return poolCount; }
+
+    DescriptorAllocator::~DescriptorAllocator() {
+        fullPools.push_back(currentPool);
+        fullPools.insert(fullPools.end(), freePools.begin(), freePools.end());
+        for (VkDescriptorPool pool : fullPools) {
+            vkDestroyDescriptorPool(device.logical, pool, nullptr);
+        }
+    }
+
+    DescriptorWriter &DescriptorWriter::writeBuffer(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset,
+                                                    VkDeviceSize range, uint32_t arrayElement) {
+        bufferInfos.push_back({buffer, offset, range});
+
+        VkWriteDescriptorSet write = {};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = binding;
+        write.dstArrayElement = arrayElement;
+        write.descriptorCount = 1;
+        write.descriptorType = type;
+        write.pBufferInfo = &bufferInfos.back();
+        writes.push_back(write);
+        return *this;
+    }
+
+    DescriptorWriter &DescriptorWriter::writeImage(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler,
+                                                   VkImageLayout layout, uint32_t arrayElement) {
+        imageInfos.push_back({sampler, view, layout});
+
+        VkWriteDescriptorSet write = {};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = binding;
+        write.dstArrayElement = arrayElement;
+        write.descriptorCount = 1;
+        write.descriptorType = type;
+        write.pImageInfo = &imageInfos.back();
+        writes.push_back(write);
+        return *this;
+    }
+
+    bool DescriptorWriter::empty() const { return writes.empty(); }
+
+    void DescriptorWriter::update(VkDevice device) {
+        if (!writes.empty()) {
+            vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+        writes.clear();
+        bufferInfos.clear();
+        imageInfos.clear();
+    }
+
+} // namespace HLVulkan
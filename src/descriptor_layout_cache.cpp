@@ -0,0 +1,58 @@
+#include "descriptor_layout_cache.hpp"
+
+#include <algorithm>
+
+namespace HLVulkan {
+
+    DescriptorSetLayoutCache::DescriptorSetLayoutCache(VkDevice device) : device(device) {}
+
+    VkDescriptorSetLayout DescriptorSetLayoutCache::getLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+                                                              VkDescriptorSetLayoutCreateFlags flags) {
+
+        // Sorted by binding number so that the key doesn't depend on declaration order
+        std::vector<VkDescriptorSetLayoutBinding> sorted = bindings;
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b) { return a.binding < b.binding; });
+
+        StateKey key;
+        key.add(flags).add(sorted);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = layouts.find(key);
+        if (it != layouts.end()) {
+            return it->second;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.flags = flags;
+        layoutInfo.bindingCount = static_cast<uint32_t>(sorted.size());
+        layoutInfo.pBindings = sorted.data();
+
+        VkDescriptorSetLayout layout;
+        VK_CHECK_RET_NULL(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout));
+        layouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    size_t DescriptorSetLayoutCache::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return layouts.size();
+    }
+
+    void DescriptorSetLayoutCache::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &entry : layouts) {
+            vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+        }
+        layouts.clear();
+    }
+
+    DescriptorSetLayoutCache::~DescriptorSetLayoutCache() {
+        for (const auto &entry : layouts) {
+            vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+        }
+    }
+
+} // namespace HLVulkan
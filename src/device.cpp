@@ -1,37 +1,29 @@
 #include "device.hpp"
 
-namespace HLVulkan {
-
-    Device::Device(VkPhysicalDevice physicalDevice, VkDevice device) : physical(physicalDevice), logical(device) {}
-    Device::Device(const Device &device) : physical(device.physical), logical(device.logical) {}
-
-    std::optional<uint32_t> Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+#include <algorithm>
 
-        // Query physical device for available types of memory
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physical, &memProperties);
-
-        // Check each type of memory
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
-            }
-        }
+namespace HLVulkan {
 
-        // No suitable type found
-        return {};
+    Device::Device(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t instanceApiVersion, const std::vector<const char *> &enabledExtensions)
+        : physical(physicalDevice), logical(device), capabilities(std::make_shared<DeviceCapabilities>(physicalDevice, instanceApiVersion)),
+          allocator(std::make_shared<MemoryAllocator>(capabilities, device)), shaderLibrary(std::make_shared<ShaderLibrary>(device)),
+          descriptorLayoutCache(std::make_shared<DescriptorSetLayoutCache>(device)), framebufferCache(std::make_shared<FramebufferCache>(device)),
+          renderPassRegistry(std::make_shared<RenderPassRegistry>()),
+          enabledExtensions(std::make_shared<const std::vector<std::string>>(enabledExtensions.begin(), enabledExtensions.end())) {}
+    Device::Device(const Device &device)
+        : physical(device.physical), logical(device.logical), capabilities(device.capabilities), allocator(device.allocator),
+          shaderLibrary(device.shaderLibrary), descriptorLayoutCache(device.descriptorLayoutCache), framebufferCache(device.framebufferCache),
+          renderPassRegistry(device.renderPassRegistry), enabledExtensions(device.enabledExtensions) {}
+
+    std::optional<uint32_t> Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferred) const {
+        return capabilities->findMemoryType(typeFilter, properties, preferred);
     }
 
     VkFormat Device::findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features) const {
 
         // Check each candidate format for the necessary features
         for (VkFormat format : candidates) {
-            VkFormatProperties props;
-            vkGetPhysicalDeviceFormatProperties(physical, format, &props);
-
-            if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
-                return format;
-            } else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features) {
+            if (capabilities->supportsFormat(format, tiling, features)) {
                 return format;
             }
         }
@@ -45,4 +37,27 @@ namespace HLVulkan {
                                    VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
     }
 
+    const DeviceCapabilities &Device::getCapabilities() const { return *capabilities; }
+
+    MemoryAllocator &Device::getAllocator() const { return *allocator; }
+
+    ShaderLibrary &Device::getShaderLibrary() const { return *shaderLibrary; }
+
+    DescriptorSetLayoutCache &Device::getDescriptorLayoutCache() const { return *descriptorLayoutCache; }
+
+    FramebufferCache &Device::getFramebufferCache() const { return *framebufferCache; }
+
+    RenderPassRegistry &Device::getRenderPassRegistry() const { return *renderPassRegistry; }
+
+    bool Device::isExtensionEnabled(const char *name) const {
+        return std::find(enabledExtensions->begin(), enabledExtensions->end(), name) != enabledExtensions->end();
+    }
+
+    void Device::destroy() {
+        framebufferCache->clear();
+        descriptorLayoutCache->clear();
+        shaderLibrary->clear();
+        allocator->clear();
+    }
+
 } // namespace HLVulkan
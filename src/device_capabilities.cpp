@@ -0,0 +1,161 @@
+#include "device_capabilities.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <string.h>
+#include <tuple>
+
+namespace HLVulkan {
+
+    static size_t countFlags(VkMemoryPropertyFlags flags) { return std::bitset<32>(flags).count(); }
+
+    DeviceCapabilities::DeviceCapabilities(VkPhysicalDevice physical, uint32_t instanceApiVersion) : physical(physical) {
+        VK_CHECK_NOT_NULL(physical);
+
+        vkGetPhysicalDeviceProperties(physical, &properties);
+        vkGetPhysicalDeviceFeatures(physical, &features);
+        vkGetPhysicalDeviceMemoryProperties(physical, &memProperties);
+        for (uint32_t format = 0; format < CORE_FORMAT_COUNT; format++) {
+            vkGetPhysicalDeviceFormatProperties(physical, static_cast<VkFormat>(format), &coreFormats[format]);
+        }
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physical, &queueFamilyCount, nullptr);
+        queueFamilies.resize(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physical, &queueFamilyCount, queueFamilies.data());
+
+        // Features can only be queried through vkGetPhysicalDeviceFeatures2 (Vulkan 1.1), chaining the structures of what the device has. Core
+        // functionality is limited by the instance version as much as by the device's, calling it on a 1.0 instance is invalid.
+        const uint32_t apiVersion = std::min(properties.apiVersion, instanceApiVersion);
+        if (apiVersion >= VK_API_VERSION_1_1) {
+            VkPhysicalDeviceFeatures2 features2 = {};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+            const bool hasDynamicStateExtension = hasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+            VkPhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicStateFeatures = {};
+            dynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+            if (hasDynamicStateExtension) {
+                dynamicStateFeatures.pNext = features2.pNext;
+                features2.pNext = &dynamicStateFeatures;
+            }
+
+            // Core in Vulkan 1.2, the library calls vkResetQueryPool and the semaphore functions rather than the extensions' entry points
+            VkPhysicalDeviceHostQueryResetFeatures hostQueryResetFeatures = {};
+            hostQueryResetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES;
+            VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = {};
+            timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+            if (apiVersion >= VK_API_VERSION_1_2) {
+                hostQueryResetFeatures.pNext = features2.pNext;
+                timelineSemaphoreFeatures.pNext = &hostQueryResetFeatures;
+                features2.pNext = &timelineSemaphoreFeatures;
+            }
+
+            vkGetPhysicalDeviceFeatures2(physical, &features2);
+            extendedDynamicState = hasDynamicStateExtension && dynamicStateFeatures.extendedDynamicState == VK_TRUE;
+            hostQueryReset = hostQueryResetFeatures.hostQueryReset == VK_TRUE;
+            timelineSemaphores = timelineSemaphoreFeatures.timelineSemaphore == VK_TRUE;
+        }
+    }
+
+    bool DeviceCapabilities::hasExtension(const char *name) const {
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(physical, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physical, nullptr, &extensionCount, extensions.data());
+        return std::any_of(extensions.begin(), extensions.end(),
+                           [name](const VkExtensionProperties &extension) { return strcmp(extension.extensionName, name) == 0; });
+    }
+
+    const VkPhysicalDeviceProperties &DeviceCapabilities::getProperties() const { return properties; }
+
+    const VkPhysicalDeviceFeatures &DeviceCapabilities::getFeatures() const { return features; }
+
+    const VkPhysicalDeviceMemoryProperties &DeviceCapabilities::getMemoryProperties() const { return memProperties; }
+
+    std::vector<uint32_t> DeviceCapabilities::rankMemoryTypes(const MemoryTypeQuery &query) const {
+
+        std::vector<uint32_t> candidates;
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            if ((query.typeBits & (1u << i)) && (memProperties.memoryTypes[i].propertyFlags & query.required) == query.required) {
+                candidates.push_back(i);
+            }
+        }
+
+        auto rank = [this, &query](uint32_t type) {
+            VkMemoryPropertyFlags flags = memProperties.memoryTypes[type].propertyFlags;
+            return std::make_tuple(countFlags(flags & query.preferred), -static_cast<int>(countFlags(flags & ~(query.required | query.preferred))),
+                                   memProperties.memoryHeaps[memProperties.memoryTypes[type].heapIndex].size);
+        };
+        std::stable_sort(candidates.begin(), candidates.end(), [&rank](uint32_t a, uint32_t b) { return rank(a) > rank(b); });
+        return candidates;
+    }
+
+    const std::vector<uint32_t> &DeviceCapabilities::getMemoryTypes(uint32_t typeBits, VkMemoryPropertyFlags required,
+                                                                    VkMemoryPropertyFlags preferred) const {
+        MemoryTypeQuery query = {typeBits, required, preferred};
+
+        // Rankings are computed on first use, there are far too many combinations to build them all up front
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = memoryTypes.find(query);
+        if (it == memoryTypes.end()) {
+            it = memoryTypes.emplace(query, rankMemoryTypes(query)).first;
+        }
+        return it->second;
+    }
+
+    std::optional<uint32_t> DeviceCapabilities::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const {
+        const std::vector<uint32_t> &types = getMemoryTypes(typeBits, required, preferred);
+        if (types.empty()) {
+            return {};
+        }
+        return types.front();
+    }
+
+    VkFormatProperties DeviceCapabilities::getFormatProperties(VkFormat format) const {
+        if (static_cast<uint32_t>(format) < CORE_FORMAT_COUNT) {
+            return coreFormats[format];
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = extensionFormats.find(format);
+        if (it == extensionFormats.end()) {
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(physical, format, &formatProperties);
+            it = extensionFormats.emplace(format, formatProperties).first;
+        }
+        return it->second;
+    }
+
+    bool DeviceCapabilities::supportsFormat(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features) const {
+        VkFormatProperties formatProperties = getFormatProperties(format);
+        if (tiling == VK_IMAGE_TILING_LINEAR) {
+            return (formatProperties.linearTilingFeatures & features) == features;
+        } else if (tiling == VK_IMAGE_TILING_OPTIMAL) {
+            return (formatProperties.optimalTilingFeatures & features) == features;
+        }
+        return false;
+    }
+
+    const std::vector<VkQueueFamilyProperties> &DeviceCapabilities::getQueueFamilies() const { return queueFamilies; }
+
+    std::optional<uint32_t> DeviceCapabilities::findQueueFamily(VkQueueFlags required, VkQueueFlags excluded) const {
+        for (uint32_t family = 0; family < queueFamilies.size(); family++) {
+            VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if (queueFamilies[family].queueCount != 0 && (flags & required) == required && (flags & excluded) == 0) {
+                return family;
+            }
+        }
+        return {};
+    }
+
+    std::optional<uint32_t> DeviceCapabilities::findTransferQueueFamily() const {
+        return findQueueFamily(VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+    }
+
+    bool DeviceCapabilities::supportsExtendedDynamicState() const { return extendedDynamicState; }
+
+    bool DeviceCapabilities::supportsHostQueryReset() const { return hostQueryReset; }
+
+    bool DeviceCapabilities::supportsTimelineSemaphores() const { return timelineSemaphores; }
+
+} // namespace HLVulkan
@@ -1,18 +1,29 @@
 #include "fence.hpp"
 
+#include "stats.hpp"
+
 namespace HLVulkan {
 
-    Fence::Fence(Device device) : device(device) {
+    Fence::Fence(Device device, bool signaled) : device(device) {
 
         VkFenceCreateInfo fenceInfo = {};
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        fenceInfo.flags = signaled ? VK_FENCE_CREATE_SIGNALED_BIT : 0;
 
         VK_CHECK_FAIL(vkCreateFence(device.logical, &fenceInfo, nullptr, &fence), "failed to create fence");
     }
 
     const VkFence Fence::getFence() { return fence; }
 
+    VkResult Fence::wait(uint64_t timeout) const {
+        HL_VULKAN_STATS_TIME(FENCE_WAIT);
+        return vkWaitForFences(device.logical, 1, &fence, VK_TRUE, timeout);
+    }
+
+    VkResult Fence::reset() { return vkResetFences(device.logical, 1, &fence); }
+
+    bool Fence::isSignaled() const { return vkGetFenceStatus(device.logical, fence) == VK_SUCCESS; }
+
     Fence::~Fence() { vkDestroyFence(device.logical, fence, nullptr); }
 
-} // namespace HLVulkan
\ No newline at end of file
+} // namespace HLVulkan
@@ -0,0 +1,155 @@
+#include "frame_manager.hpp"
+
+#include "stats.hpp"
+
+namespace HLVulkan {
+
+    FrameManager::FrameManager(Device device, Queue queue, uint32_t framesInFlight, VkDeviceSize ringSize, VkBufferUsageFlags ringUsage)
+        : device(device), queue(queue), frames(framesInFlight) {
+
+        ASSERT_MSG(framesInFlight != 0, "framesInFlight must be strictly positive");
+
+        for (FrameContext &frame : frames) {
+            frame.fence = std::make_unique<Fence>(device);
+            frame.commandPool = std::make_unique<CommandPool>(device, queue, 0, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        }
+        if (ringSize != 0) {
+            ringBuffer = std::make_unique<RingBuffer>(device, ringSize, ringUsage, framesInFlight);
+        }
+    }
+
+    FrameManager::FrameContext &FrameManager::current() { return frames[(frameCount - 1) % frames.size()]; }
+
+    void FrameManager::runReleases(FrameContext &frame) {
+        for (auto &release : frame.releases) {
+            release();
+        }
+        frame.releases.clear();
+    }
+
+    VkResult FrameManager::beginFrame(uint64_t timeout) {
+
+        ASSERT_MSG(!recording, "endFrame() wasn't called for the previous frame");
+
+        // The context is only free once the frame that used it framesInFlight frames ago is done
+        FrameContext &frame = frames[frameCount % frames.size()];
+        if (frame.submitted) {
+            VK_CHECK_RET(frame.fence->wait(timeout));
+            frame.submitted = false;
+        }
+        runReleases(frame);
+        VK_CHECK_RET(frame.commandPool->reset());
+
+        frame.commandBuffer = frame.commandPool->acquireCommandBuffer();
+        if (frame.commandBuffer == VK_NULL_HANDLE) {
+            return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        }
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK_RET(vkBeginCommandBuffer(frame.commandBuffer, &beginInfo));
+
+        if (ringBuffer) {
+            ringBuffer->beginFrame();
+        }
+        frameCount++;
+        recording = true;
+        return VK_SUCCESS;
+    }
+
+    VkResult FrameManager::endFrame(const std::vector<VkSemaphore> &waitSemaphores, const std::vector<VkPipelineStageFlags> &waitStages,
+                                    const std::vector<VkSemaphore> &signalSemaphores) {
+
+        ASSERT_MSG(recording, "beginFrame() wasn't called");
+        ASSERT_MSG(waitSemaphores.size() == waitStages.size(), "one wait stage per wait semaphore");
+        recording = false;
+
+        FrameContext &frame = current();
+        if (ringBuffer) {
+            VK_CHECK_RET(ringBuffer->endFrame());
+        }
+        VK_CHECK_RET(vkEndCommandBuffer(frame.commandBuffer));
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &frame.commandBuffer;
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        // The fence is only waited for once the submission succeeded, so a failure can't block beginFrame()
+        VK_CHECK_RET(frame.fence->reset());
+        HL_VULKAN_STATS_ADD(QUEUE_SUBMIT_CALLS, 1);
+        {
+            std::lock_guard<std::mutex> lock(*queue.mutex);
+            VK_CHECK_RET(vkQueueSubmit(queue.queue, 1, &submitInfo, frame.fence->getFence()));
+        }
+        frame.submitted = true;
+        return VK_SUCCESS;
+    }
+
+    void FrameManager::deferRelease(std::function<void()> release) {
+        ASSERT_MSG(frameCount != 0, "no frame begun yet");
+        current().releases.push_back(std::move(release));
+    }
+
+    void FrameManager::keepAlive(std::shared_ptr<void> resource) {
+        deferRelease([resource]() mutable { resource.reset(); });
+    }
+
+    VkCommandBuffer FrameManager::getCommandBuffer() const {
+        ASSERT_MSG(recording, "beginFrame() wasn't called");
+        return frames[(frameCount - 1) % frames.size()].commandBuffer;
+    }
+
+    CommandPool &FrameManager::getCommandPool() {
+        ASSERT_MSG(frameCount != 0, "no frame begun yet");
+        return *current().commandPool;
+    }
+
+    std::optional<RingAllocation> FrameManager::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+        ASSERT_MSG(ringBuffer, "no ring buffer, see ringSize");
+        ASSERT_MSG(recording, "beginFrame() wasn't called");
+        if (!ringBuffer) {
+            return {};
+        }
+        return ringBuffer->allocate(size, alignment);
+    }
+
+    uint32_t FrameManager::getFrameIndex() const { return static_cast<uint32_t>((frameCount == 0 ? 0 : frameCount - 1) % frames.size()); }
+
+    uint64_t FrameManager::getFrameCount() const { return frameCount; }
+
+    uint32_t FrameManager::getFramesInFlight() const { return static_cast<uint32_t>(frames.size()); }
+
+    VkResult FrameManager::waitIdle() {
+        VkResult ret = VK_SUCCESS;
+        for (FrameContext &frame : frames) {
+            // The frame being recorded still needs its resources
+            if (recording && &frame == &current()) {
+                continue;
+            }
+            if (frame.submitted) {
+                VkResult waited = frame.fence->wait();
+                if (waited != VK_SUCCESS) {
+                    ret = waited;
+                    continue;
+                }
+                frame.submitted = false;
+            }
+            runReleases(frame);
+        }
+        return ret;
+    }
+
+    FrameManager::~FrameManager() {
+        // A frame still being recorded is never submitted, its releases can run right away
+        recording = false;
+        VK_CHECK_FAIL(waitIdle(), "failed to wait for the frames in flight");
+    }
+
+} // namespace HLVulkan
@@ -0,0 +1,88 @@
+#include "framebuffer_cache.hpp"
+
+#include <algorithm>
+
+#include "image.hpp"
+#include "render_pass_spec.hpp"
+
+namespace HLVulkan {
+
+    FramebufferCache::FramebufferCache(VkDevice device) : device(device) {}
+
+    VkFramebuffer FramebufferCache::getFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView> &attachments, VkExtent2D extent,
+                                                   uint32_t layers) {
+        StateKey key;
+        key.add(renderPass).add(attachments).add(extent.width).add(extent.height).add(layers);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = framebuffers.find(key);
+        if (it != framebuffers.end()) {
+            return it->second.framebuffer;
+        }
+
+        VkFramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = layers;
+
+        VkFramebuffer framebuffer;
+        VK_CHECK_RET_NULL(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer));
+        framebuffers.emplace(std::move(key), Entry{framebuffer, renderPass, attachments});
+        return framebuffer;
+    }
+
+    VkFramebuffer FramebufferCache::getFramebuffer(VkRenderPass renderPass, const RenderPassSpec &spec, const std::vector<const Image *> &images,
+                                                   VkExtent2D extent, uint32_t layers) {
+        if (!spec.checkTransientAttachments(images)) {
+            return VK_NULL_HANDLE;
+        }
+
+        std::vector<VkImageView> attachments;
+        for (const Image *image : images) {
+            ASSERT_MSG(image != nullptr, "every attachment needs an image");
+            attachments.push_back(image->getView());
+        }
+        return getFramebuffer(renderPass, attachments, extent, layers);
+    }
+
+    template <class Predicate> void FramebufferCache::evict(Predicate predicate) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = framebuffers.begin(); it != framebuffers.end();) {
+            if (predicate(it->second)) {
+                vkDestroyFramebuffer(device, it->second.framebuffer, nullptr);
+                it = framebuffers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void FramebufferCache::evictView(VkImageView view) {
+        evict([view](const Entry &entry) { return std::find(entry.attachments.begin(), entry.attachments.end(), view) != entry.attachments.end(); });
+    }
+
+    void FramebufferCache::evictRenderPass(VkRenderPass renderPass) {
+        evict([renderPass](const Entry &entry) { return entry.renderPass == renderPass; });
+    }
+
+    size_t FramebufferCache::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return framebuffers.size();
+    }
+
+    void FramebufferCache::clear() {
+        evict([](const Entry &) { return true; });
+    }
+
+    FramebufferCache::~FramebufferCache() {
+        for (const auto &entry : framebuffers) {
+            vkDestroyFramebuffer(device, entry.second.framebuffer, nullptr);
+        }
+    }
+
+} // namespace HLVulkan
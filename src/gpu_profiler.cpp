@@ -0,0 +1,223 @@
+#include "gpu_profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace HLVulkan {
+
+    static std::string escapeJson(const std::string &text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    static uint64_t getTimestampMask(const DeviceCapabilities &capabilities, uint32_t queueFamily) {
+        const std::vector<VkQueueFamilyProperties> &families = capabilities.getQueueFamilies();
+        uint32_t validBits = queueFamily < families.size() ? families[queueFamily].timestampValidBits : 0;
+        return validBits >= 64 ? UINT64_MAX : (static_cast<uint64_t>(1) << validBits) - 1;
+    }
+
+    GpuProfiler::GpuProfiler(Device device, uint32_t queueFamily, uint32_t framesInFlight, uint32_t maxZonesPerFrame)
+        : device(device), maxZonesPerFrame(maxZonesPerFrame), timestampPeriod(device.getCapabilities().getProperties().limits.timestampPeriod),
+          timestampMask(getTimestampMask(device.getCapabilities(), queueFamily)), frames(framesInFlight) {
+
+        ASSERT_MSG(framesInFlight != 0, "framesInFlight must be strictly positive");
+        ASSERT_MSG(maxZonesPerFrame != 0, "maxZonesPerFrame must be strictly positive");
+        ASSERT_MSG(timestampMask != 0, "queue family doesn't support timestamps");
+        ASSERT_MSG(device.getCapabilities().supportsHostQueryReset(), "device doesn't support host query reset");
+
+        // Two timestamps per zone
+        VkQueryPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = 2 * maxZonesPerFrame;
+
+        for (FrameQueries &queries : frames) {
+            VK_CHECK_FAIL(vkCreateQueryPool(device.logical, &poolInfo, nullptr, &queries.pool), "failed to create timestamp query pool");
+            vkResetQueryPool(device.logical, queries.pool, 0, poolInfo.queryCount);
+        }
+    }
+
+    GpuProfiler::FrameQueries &GpuProfiler::current() { return frames[frameCount % frames.size()]; }
+
+    void GpuProfiler::beginFrame() {
+        std::lock_guard<std::mutex> lock(mutex);
+        frameCount++;
+        FrameQueries &queries = current();
+        collect(queries, false);
+        queries.frame = frameCount;
+    }
+
+    bool GpuProfiler::isAvailable(const FrameQueries &queries) const {
+        if (std::find(queries.ended.begin(), queries.ended.end(), false) != queries.ended.end()) {
+            return false;
+        }
+
+        // NOT_READY unless every timestamp landed
+        const uint32_t queryCount = static_cast<uint32_t>(2 * queries.names.size());
+        std::vector<uint64_t> results(queryCount);
+        return vkGetQueryPoolResults(device.logical, queries.pool, 0, queryCount, results.size() * sizeof(uint64_t), results.data(), sizeof(uint64_t),
+                                     VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+    }
+
+    void GpuProfiler::collect(FrameQueries &queries, bool wait) {
+
+        if (queries.names.empty()) {
+            return;
+        }
+
+        // Value and availability of each timestamp, zones whose timestamps never landed are dropped
+        const uint32_t queryCount = static_cast<uint32_t>(2 * queries.names.size());
+        std::vector<uint64_t> results(2 * queryCount);
+        const VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+        VkResult ret = vkGetQueryPoolResults(device.logical, queries.pool, 0, queryCount, results.size() * sizeof(uint64_t), results.data(),
+                                             2 * sizeof(uint64_t), flags);
+
+        for (size_t zone = 0; zone < queries.names.size(); zone++) {
+            uint64_t *begin = &results[4 * zone];
+            uint64_t *end = &results[4 * zone + 2];
+
+            // Both timestamps of an ended zone were recorded, so they land once the frame completes
+            if (wait && queries.ended[zone] && ret == VK_NOT_READY && (begin[1] == 0 || end[1] == 0)) {
+                if (vkGetQueryPoolResults(device.logical, queries.pool, static_cast<uint32_t>(2 * zone), 2, 4 * sizeof(uint64_t), begin,
+                                          2 * sizeof(uint64_t), flags | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+                    begin[1] = 0;
+                }
+            }
+
+            if ((ret != VK_SUCCESS && ret != VK_NOT_READY) || begin[1] == 0 || end[1] == 0) {
+                droppedCount++;
+                continue;
+            }
+
+            // Timestamps wrap around past the valid bits
+            zones.push_back({queries.names[zone], queries.frame, static_cast<uint64_t>((begin[0] & timestampMask) * timestampPeriod),
+                             static_cast<uint64_t>(((end[0] - begin[0]) & timestampMask) * timestampPeriod)});
+        }
+
+        vkResetQueryPool(device.logical, queries.pool, 0, queryCount);
+        queries.names.clear();
+        queries.ended.clear();
+    }
+
+    uint32_t GpuProfiler::beginZone(VkCommandBuffer commandBuffer, const std::string &name) {
+
+        uint32_t zone;
+        VkQueryPool pool;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            FrameQueries &queries = current();
+            if (queries.names.size() == maxZonesPerFrame) {
+                droppedCount++;
+                return INVALID_ZONE;
+            }
+            zone = static_cast<uint32_t>(queries.names.size());
+            queries.names.push_back(name);
+            queries.ended.push_back(false);
+            pool = queries.pool;
+        }
+
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, 2 * zone);
+        return zone;
+    }
+
+    void GpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t zone) {
+
+        if (zone == INVALID_ZONE) {
+            return;
+        }
+
+        VkQueryPool pool;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            FrameQueries &queries = current();
+            ASSERT_MSG(zone < queries.ended.size(), "zone ended in another frame");
+            queries.ended[zone] = true;
+            pool = queries.pool;
+        }
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, 2 * zone + 1);
+    }
+
+    void GpuProfiler::collectAll() {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Oldest frame first. Waiting for timestamps that are never written would hang, so the current frame isn't waited for.
+        for (size_t i = 1; i < frames.size(); i++) {
+            collect(frames[(frameCount + i) % frames.size()], true);
+        }
+        if (isAvailable(current())) {
+            collect(current(), false);
+        }
+    }
+
+    std::vector<GpuZone> GpuProfiler::getZones() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return zones;
+    }
+
+    void GpuProfiler::clearZones() {
+        std::lock_guard<std::mutex> lock(mutex);
+        zones.clear();
+    }
+
+    size_t GpuProfiler::getDroppedCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return droppedCount;
+    }
+
+    bool GpuProfiler::writeChromeTrace(const std::string &filename) const {
+
+        std::vector<GpuZone> snapshot = getZones();
+
+        // Trace timestamps are in microseconds, relative to the first zone
+        uint64_t origin = UINT64_MAX;
+        for (const GpuZone &zone : snapshot) {
+            origin = std::min(origin, zone.startNs);
+        }
+
+        std::ostringstream json;
+        json.setf(std::ios::fixed);
+        json.precision(3);
+        json << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+        json << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"GPU\"}}";
+        for (const GpuZone &zone : snapshot) {
+            json << ",\n  {\"name\": \"" << escapeJson(zone.name) << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, \"ts\": " << (zone.startNs - origin) / 1000.0
+                 << ", \"dur\": " << zone.durationNs / 1000.0 << ", \"args\": {\"frame\": " << zone.frame << "}}";
+        }
+        json << "\n]}\n";
+        const std::string data = json.str();
+
+        return writeFileAtomically(filename, data.data(), data.size());
+    }
+
+    GpuProfiler::~GpuProfiler() {
+        for (FrameQueries &queries : frames) {
+            vkDestroyQueryPool(device.logical, queries.pool, nullptr);
+        }
+    }
+
+    ScopedZone::ScopedZone(GpuProfiler *profiler, VkCommandBuffer commandBuffer, const std::string &name) : profiler(profiler), commandBuffer(commandBuffer) {
+        if (profiler) {
+            zone = profiler->beginZone(commandBuffer, name);
+        }
+    }
+
+    ScopedZone::~ScopedZone() {
+        if (profiler) {
+            profiler->endZone(commandBuffer, zone);
+        }
+    }
+
+} // namespace HLVulkan
@@ -1,3 +1,85 @@
 #include "hl_vulkan.hpp"
 
-bool HLVulkan::hasStencilComponent(VkFormat format) { return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT; }
\ No newline at end of file
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HL_VULKAN_HAS_FSYNC
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <fstream>
+#include <process.h>
+#include <windows.h>
+#endif
+
+bool HLVulkan::hasStencilComponent(VkFormat format) {
+    return format == VK_FORMAT_S8_UINT || format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+           format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+bool HLVulkan::hasDepthComponent(VkFormat format) {
+    return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT ||
+           format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+std::vector<uint32_t> HLVulkan::getDistinctQueueFamilies(const std::vector<uint32_t> &queueFamilies) {
+    std::vector<uint32_t> families = queueFamilies;
+    std::sort(families.begin(), families.end());
+    families.erase(std::unique(families.begin(), families.end()), families.end());
+    return families;
+}
+
+static int processId() {
+#ifdef HL_VULKAN_HAS_FSYNC
+    return static_cast<int>(getpid());
+#else
+    return _getpid();
+#endif
+}
+
+bool HLVulkan::writeFileAtomically(const std::string &filename, const char *data, size_t size) {
+
+    // Unique per process and per call, so that concurrent writers of the same destination never share a temporary file
+    static std::atomic<uint32_t> tmpFileCount(0);
+    const std::string tmpFile = filename + ".tmp." + std::to_string(processId()) + "." + std::to_string(tmpFileCount++);
+
+    bool written = true;
+#ifdef HL_VULKAN_HAS_FSYNC
+    int fd = open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    for (size_t offset = 0; written && offset < size;) {
+        ssize_t ret = write(fd, data + offset, size - offset);
+        if (ret > 0) {
+            offset += static_cast<size_t>(ret);
+        } else if (ret == 0 || errno != EINTR) {
+            written = false;
+        }
+    }
+
+    // The content has to be on disk before the rename is, or a crash could leave an empty file under the destination name
+    written = written && fsync(fd) == 0;
+    written = close(fd) == 0 && written;
+    const bool renamed = written && std::rename(tmpFile.c_str(), filename.c_str()) == 0;
+#else
+    {
+        std::ofstream file(tmpFile, std::ios::binary | std::ios::trunc);
+        written = file.is_open() && file.write(data, size) && file.flush();
+    }
+
+    // rename() refuses to replace an existing file here, which every save after the first one does
+    const bool renamed = written && MoveFileExA(tmpFile.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#endif
+
+    if (!renamed) {
+        std::remove(tmpFile.c_str());
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
@@ -1,10 +1,59 @@
 #include "image.hpp"
 
+#include <algorithm>
 #include <optional>
 
+#include "barrier_batch.hpp"
+#include "stats.hpp"
+
 namespace HLVulkan {
 
-    VkResult Image::createImage(VkDevice device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImage &image) {
+#ifdef HL_VULKAN_ENABLE_STATS
+    struct TexelBlock {
+        VkFormat last; // Covers the formats following the previous entry up to this one
+        uint32_t bytes;
+        uint32_t size; // Width and height in texels
+    };
+
+    // Core formats up to the ETC2 and EAC ones, in enum order
+    static const TexelBlock TEXEL_BLOCKS[] = {
+        {VK_FORMAT_R4G4_UNORM_PACK8, 1, 1},         {VK_FORMAT_A1R5G5B5_UNORM_PACK16, 2, 1},     {VK_FORMAT_R8_SRGB, 1, 1},
+        {VK_FORMAT_R8G8_SRGB, 2, 1},                {VK_FORMAT_B8G8R8_SRGB, 3, 1},               {VK_FORMAT_A2B10G10R10_SINT_PACK32, 4, 1},
+        {VK_FORMAT_R16_SFLOAT, 2, 1},               {VK_FORMAT_R16G16_SFLOAT, 4, 1},             {VK_FORMAT_R16G16B16_SFLOAT, 6, 1},
+        {VK_FORMAT_R16G16B16A16_SFLOAT, 8, 1},      {VK_FORMAT_R32_SFLOAT, 4, 1},                {VK_FORMAT_R32G32_SFLOAT, 8, 1},
+        {VK_FORMAT_R32G32B32_SFLOAT, 12, 1},        {VK_FORMAT_R32G32B32A32_SFLOAT, 16, 1},      {VK_FORMAT_R64_SFLOAT, 8, 1},
+        {VK_FORMAT_R64G64_SFLOAT, 16, 1},           {VK_FORMAT_R64G64B64_SFLOAT, 24, 1},         {VK_FORMAT_R64G64B64A64_SFLOAT, 32, 1},
+        {VK_FORMAT_E5B9G9R9_UFLOAT_PACK32, 4, 1},   {VK_FORMAT_D32_SFLOAT_S8_UINT, 0, 0},        {VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 8, 4},
+        {VK_FORMAT_BC3_SRGB_BLOCK, 16, 4},          {VK_FORMAT_BC4_SNORM_BLOCK, 8, 4},           {VK_FORMAT_BC7_SRGB_BLOCK, 16, 4},
+        {VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK, 8, 4}, {VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, 16, 4}, {VK_FORMAT_EAC_R11_SNORM_BLOCK, 8, 4},
+        {VK_FORMAT_EAC_R11G11_SNORM_BLOCK, 16, 4},
+    };
+
+    // Bytes written by a copy of the first levelCount levels from tightly packed buffer data. Depth and stencil formats and the formats past
+    // the table (ASTC, multi-planar...) count the whole source buffer instead.
+    static VkDeviceSize getUploadSize(const Image &image, uint32_t levelCount, const Buffer &srcBuffer) {
+        for (const TexelBlock &block : TEXEL_BLOCKS) {
+            if (image.getFormat() > block.last) {
+                continue;
+            }
+            if (block.bytes == 0) {
+                break;
+            }
+
+            VkDeviceSize size = 0;
+            for (uint32_t mipLevel = 0; mipLevel < levelCount; mipLevel++) {
+                VkExtent2D extent = image.getLevelExtent(mipLevel);
+                size += static_cast<VkDeviceSize>((extent.width + block.size - 1) / block.size) * ((extent.height + block.size - 1) / block.size) *
+                        block.bytes;
+            }
+            return size * image.getArrayLayers();
+        }
+        return srcBuffer.getSize();
+    }
+#endif
+
+    VkResult Image::createImage(VkDevice device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImage &image,
+                                uint32_t mipLevels, const std::vector<uint32_t> &queueFamilies) {
 
         VkImageCreateInfo imageInfo = {};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -12,19 +61,24 @@ namespace HLVulkan {
         imageInfo.extent.width = extent.width;
         imageInfo.extent.height = extent.height;
         imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = 1;
+        imageInfo.mipLevels = mipLevels;
         imageInfo.arrayLayers = 1;
         imageInfo.format = format;
         imageInfo.tiling = tiling;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         imageInfo.usage = usage;
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.sharingMode = queueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+        if (imageInfo.sharingMode == VK_SHARING_MODE_CONCURRENT) {
+            imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+            imageInfo.pQueueFamilyIndices = queueFamilies.data();
+        }
 
         return vkCreateImage(device, &imageInfo, nullptr, &image);
     }
 
-    VkResult Image::createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect, VkImageView &imageView) {
+    VkResult Image::createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect, VkImageView &imageView,
+                                    uint32_t baseMipLevel, uint32_t levelCount) {
 
         VkImageViewCreateInfo viewInfo = {};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -32,53 +86,87 @@ namespace HLVulkan {
         viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
         viewInfo.format = format;
         viewInfo.subresourceRange.aspectMask = aspect;
-        viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
+        viewInfo.subresourceRange.levelCount = levelCount;
         viewInfo.subresourceRange.baseArrayLayer = 0;
         viewInfo.subresourceRange.layerCount = 1;
 
         return vkCreateImageView(device, &viewInfo, nullptr, &imageView);
     }
 
+    uint32_t Image::getMipLevelCount(VkExtent2D extent) {
+        uint32_t levels = 1;
+        for (uint32_t size = std::max(extent.width, extent.height); size > 1; size >>= 1) {
+            levels++;
+        }
+        return levels;
+    }
+
     Image::Image(Device device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageAspectFlags aspect,
-                 VkMemoryPropertyFlags properties)
-        : device(device), extent(extent), format(format), tiling(tiling), usage(usage), aspect(aspect) {
-        VK_CHECK_FAIL(createImage(device.logical, extent, format, tiling, usage, image), "image creation failed");
+                 VkMemoryPropertyFlags properties, uint32_t mipLevels, const std::vector<uint32_t> &queueFamilies)
+        : device(device), extent(extent), format(format), tiling(tiling), usage(usage), aspect(aspect), queueFamilies(getDistinctQueueFamilies(queueFamilies)),
+          mipLevels(mipLevels), subresourceStates(mipLevels * arrayLayers) {
+        ASSERT_MSG(mipLevels != 0 && mipLevels <= getMipLevelCount(extent), "invalid mip level count");
+        ASSERT_MSG(!isTransient() || (usage & ~(VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT)) == 0,
+                   "transient images can only be used as attachments");
+        VK_CHECK_FAIL(createImage(device.logical, extent, format, tiling, usage, image, mipLevels, this->queueFamilies), "image creation failed");
         VK_CHECK_FAIL(bind(properties), "buffer bind failed");
+        VK_CHECK_FAIL(createImageView(device.logical, image, format, aspect, imageView, 0, mipLevels), "image view creation failed");
+    }
+
+    VkResult Image::getMemoryRequirements(VkDevice device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+                                          VkMemoryRequirements &requirements, uint32_t mipLevels) {
+        VkImage image;
+        VK_CHECK_RET(createImage(device, extent, format, tiling, usage, image, mipLevels));
+        vkGetImageMemoryRequirements(device, image, &requirements);
+        vkDestroyImage(device, image, nullptr);
+        return VK_SUCCESS;
+    }
+
+    Image::Image(Device device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                 const MemoryAllocation &memory, VkDeviceSize offset)
+        : device(device), extent(extent), format(format), tiling(tiling), usage(usage), aspect(aspect), subresourceStates(mipLevels * arrayLayers) {
+        VK_CHECK_FAIL(createImage(device.logical, extent, format, tiling, usage, image), "image creation failed");
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device.logical, image, &memRequirements);
+        ASSERT_MSG((memRequirements.memoryTypeBits & (1u << memory.memoryType)) && (memory.offset + offset) % memRequirements.alignment == 0 &&
+                       offset + memRequirements.size <= memory.size,
+                   "memory doesn't fit the image");
+
+        // Without a block the allocation isn't ours to free
+        allocation = {memory.memory, memory.offset + offset, memRequirements.size, memory.memoryType, nullptr};
+        memProperties = device.getAllocator().getMemoryTypeProperties(memory.memoryType);
+        VK_CHECK_FAIL(vkBindImageMemory(device.logical, image, allocation.memory, allocation.offset), "image bind failed");
         VK_CHECK_FAIL(createImageView(device.logical, image, format, aspect, imageView), "image view creation failed");
     }
 
     VkResult Image::bind(VkMemoryPropertyFlags properties) {
 
         VK_CHECK_NOT_NULL(device.physical);
-        VK_CHECK_NULL(memory);
+        VK_CHECK_NULL(allocation.memory);
 
         this->memProperties = properties;
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device.logical, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        std::optional memType = device.findMemoryType(memRequirements.memoryTypeBits, properties);
-        if (memType) {
-            allocInfo.memoryTypeIndex = *memType;
-        } else {
-            return VK_ERROR_FEATURE_NOT_PRESENT;
-        }
+        MemoryAllocator::ResourceType type = tiling == VK_IMAGE_TILING_LINEAR ? MemoryAllocator::ResourceType::LINEAR : MemoryAllocator::ResourceType::OPTIMAL;
 
-        VK_CHECK_RET(vkAllocateMemory(device.logical, &allocInfo, nullptr, &memory));
-        return vkBindImageMemory(device.logical, image, memory, 0);
+        // Only transient images may (and then should) use lazily allocated memory, tilers never back most of it
+        VkMemoryPropertyFlags preferred = isTransient() ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0;
+        VK_CHECK_RET(device.getAllocator().allocate(memRequirements, properties, type, allocation, preferred));
+        return vkBindImageMemory(device.logical, image, allocation.memory, allocation.offset);
     }
 
-    VkResult Image::copyTo(const Image &dstImage, CommandPool &commandPool) {
+    VkResult Image::copyTo(Image &dstImage, CommandPool &commandPool) {
 
         //@ TODO: images must be bind to memory ?
         //@ TODO: include check for format features (must contain VK_FORMAT_FEATURE_TRANSFER_[SRC/DST]_BIT)
         ASSERT_MSG(usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT, "source image doesn't have required usage flag");
         ASSERT_MSG(dstImage.usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT, "destination image doesn't have required usage flag");
 
-        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands();
+        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands("Image::copyTo");
         VK_CHECK_NOT_NULL(commandBuffer);
 
         VkImageCopy imageCopyRegion = {};
@@ -91,117 +179,231 @@ namespace HLVulkan {
         imageCopyRegion.extent.depth = 1;
 
         vkCmdCopyImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopyRegion);
+        recordAccess(ResourceAccess::forLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL), 1);
+        dstImage.recordAccess(ResourceAccess::forLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL), 1);
 
         return commandPool.endSingleTimeCommands(commandBuffer);
     }
 
     VkResult Image::copyFromBuffer(VkImageLayout layout, Buffer &srcBuffer, CommandPool &commandPool) {
 
+        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands("Image::copyFromBuffer");
+        VK_CHECK_NOT_NULL(commandBuffer);
+
+        recordCopyFromBuffer(commandBuffer, layout, srcBuffer);
+        HL_VULKAN_STATS_ADD(IMAGE_UPLOAD_BYTES, getUploadSize(*this, 1, srcBuffer));
+
+        return commandPool.endSingleTimeCommands(commandBuffer);
+    }
+
+    void Image::recordCopyFromBuffer(VkCommandBuffer commandBuffer, VkImageLayout layout, Buffer &srcBuffer) {
+        recordCopyFromBuffer(commandBuffer, layout, srcBuffer, {0});
+    }
+
+    VkResult Image::copyFromBuffer(VkImageLayout layout, Buffer &srcBuffer, const std::vector<VkDeviceSize> &levelOffsets, CommandPool &commandPool) {
+
+        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands("Image::copyFromBuffer");
+        VK_CHECK_NOT_NULL(commandBuffer);
+
+        recordCopyFromBuffer(commandBuffer, layout, srcBuffer, levelOffsets);
+        HL_VULKAN_STATS_ADD(IMAGE_UPLOAD_BYTES, getUploadSize(*this, static_cast<uint32_t>(levelOffsets.size()), srcBuffer));
+
+        return commandPool.endSingleTimeCommands(commandBuffer);
+    }
+
+    void Image::recordCopyFromBuffer(VkCommandBuffer commandBuffer, VkImageLayout layout, Buffer &srcBuffer, const std::vector<VkDeviceSize> &levelOffsets) {
+
         //@ TODO: include check for format features (must contain VK_FORMAT_FEATURE_TRANSFER_DST_BIT)
         //@ TODO: check that the buffer is big enough
         //@ TODO: image must be bind to memory ?
         ASSERT_MSG((srcBuffer.getUsageFlags() & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) != 0, "buffer doesn't have required usage flag");
         ASSERT_MSG((usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0, "image doesn't have required usage flag");
         ASSERT_MSG(layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL || layout == VK_IMAGE_LAYOUT_GENERAL, "image isn't in a compatible layout");
+        ASSERT_MSG(!levelOffsets.empty() && levelOffsets.size() <= mipLevels, "invalid mip level count");
 
         VkBuffer buf = srcBuffer.getBuffer();
         VK_CHECK_NOT_NULL(buf);
 
-        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands();
+        // Create buffercopy information, one region per level
+        std::vector<VkBufferImageCopy> regions(levelOffsets.size());
+        for (uint32_t mipLevel = 0; mipLevel < regions.size(); mipLevel++) {
+            VkBufferImageCopy &region = regions[mipLevel];
+            region = {};
+            region.bufferOffset = levelOffsets[mipLevel];
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = mipLevel;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = arrayLayers;
+
+            VkExtent2D levelExtent = getLevelExtent(mipLevel);
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {levelExtent.width, levelExtent.height, 1};
+        }
+
+        vkCmdCopyBufferToImage(commandBuffer, buf, image, layout, static_cast<uint32_t>(regions.size()), regions.data());
+
+        srcBuffer.state.record({VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT}, false);
+        recordAccess({VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, layout}, static_cast<uint32_t>(regions.size()));
+    }
+
+    bool Image::supportsBlitMipmaps() const {
+        VkFormatProperties properties = device.getCapabilities().getFormatProperties(format);
+        VkFormatFeatureFlags features = tiling == VK_IMAGE_TILING_OPTIMAL ? properties.optimalTilingFeatures : properties.linearTilingFeatures;
+        VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (features & required) == required && (usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) && (usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    }
+
+    VkResult Image::generateMipmaps(CommandPool &commandPool) {
+
+        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands("Image::generateMipmaps");
         VK_CHECK_NOT_NULL(commandBuffer);
 
-        // Create buffercopy information
-        VkBufferImageCopy region = {};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
+        recordGenerateMipmaps(commandBuffer);
+
+        return commandPool.endSingleTimeCommands(commandBuffer);
+    }
+
+    void Image::recordGenerateMipmaps(VkCommandBuffer commandBuffer) {
+
+        ASSERT_MSG(supportsBlitMipmaps(), "format doesn't support linear blits, use a MipmapGenerator");
+        ASSERT_MSG(getLayout(0, 0) != VK_IMAGE_LAYOUT_UNDEFINED, "level 0 has no content");
+
+        // Each level is read back as the source of the next one, so one barrier per level is unavoidable
+        BarrierBatch barriers;
+        for (uint32_t mipLevel = 1; mipLevel < mipLevels; mipLevel++) {
+            barriers.transition(*this, {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL}, mipLevel - 1, 1);
+            barriers.transition(*this, ResourceAccess::forLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL), mipLevel, 1);
+            barriers.record(commandBuffer);
+
+            VkExtent2D srcExtent = getLevelExtent(mipLevel - 1);
+            VkExtent2D dstExtent = getLevelExtent(mipLevel);
+
+            VkImageBlit blit = {};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = mipLevel - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = arrayLayers;
+            blit.srcOffsets[1] = {static_cast<int32_t>(srcExtent.width), static_cast<int32_t>(srcExtent.height), 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = mipLevel;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = arrayLayers;
+            blit.dstOffsets[1] = {static_cast<int32_t>(dstExtent.width), static_cast<int32_t>(dstExtent.height), 1};
+
+            vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+        }
+
+        barriers.transition(*this, ResourceAccess::forLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+        barriers.record(commandBuffer);
+    }
 
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {extent.width, extent.height, 1};
+    VkResult Image::transitionImageLayout(VkImageLayout newLayout, CommandPool &commandPool) {
 
-        vkCmdCopyBufferToImage(commandBuffer, buf, image, layout, 1, &region);
+        // Create, record, and execute the command buffer
+        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands("Image::transitionImageLayout");
+        VK_CHECK_NOT_NULL(commandBuffer);
 
+        recordTransitionImageLayout(commandBuffer, newLayout);
         return commandPool.endSingleTimeCommands(commandBuffer);
     }
 
-    VkResult Image::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout, CommandPool &commandPool) {
+    void Image::recordTransitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout newLayout) {
+        BarrierBatch barriers;
+        barriers.transition(*this, ResourceAccess::forLayout(newLayout));
+        barriers.record(commandBuffer);
+    }
 
-        // Create memory barrier
-        VkImageMemoryBarrier barrier = {};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = oldLayout;
-        barrier.newLayout = newLayout;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = image;
-        if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-
-            if (hasStencilComponent(format)) {
-                barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-            }
-        } else {
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        }
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-
-        // Check that the transition is allowed
-        VkPipelineStageFlags sourceStage;
-        VkPipelineStageFlags destinationStage;
-        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        } else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        } else if (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-            barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        } else {
-            ASSERT_MSG(false, "unsupported layout transition")
-            return VK_RESULT_MAX_ENUM;
-        }
+    VkResult Image::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout, CommandPool &commandPool) {
 
         // Create, record, and execute the command buffer
-        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands();
+        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands("Image::transitionImageLayout");
         VK_CHECK_NOT_NULL(commandBuffer);
 
-        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-        VK_CHECK_RET(commandPool.endSingleTimeCommands(commandBuffer));
+        VkResult ret;
+        if ((ret = recordTransitionImageLayout(commandBuffer, oldLayout, newLayout)) != VK_SUCCESS) {
+            commandPool.abortSingleTimeCommands(commandBuffer);
+            return ret;
+        }
+        return commandPool.endSingleTimeCommands(commandBuffer);
+    }
 
+    VkResult Image::recordTransitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) {
+
+        // Trust the caller over tracking, the barrier still waits on whatever was tracked
+        for (ResourceState &state : subresourceStates) {
+            state.layout = oldLayout;
+        }
+        recordTransitionImageLayout(commandBuffer, newLayout);
         return VK_SUCCESS;
     }
 
+    void Image::discardContent(VkPipelineStageFlags stages, VkAccessFlags writeAccess) {
+        for (ResourceState &state : subresourceStates) {
+            state = ResourceState();
+            state.writeStages = stages;
+            state.writeAccess = writeAccess;
+        }
+    }
+
+    VkImageLayout Image::getLayout(uint32_t mipLevel, uint32_t arrayLayer) const {
+        ASSERT_MSG(mipLevel < mipLevels && arrayLayer < arrayLayers, "subresource out of range");
+        return subresourceStates[mipLevel * arrayLayers + arrayLayer].layout;
+    }
+
+    ResourceState &Image::getSubresourceState(uint32_t mipLevel, uint32_t arrayLayer) { return subresourceStates[mipLevel * arrayLayers + arrayLayer]; }
+
+    // Every layer of the first levelCount levels
+    void Image::recordAccess(const ResourceAccess &access, uint32_t levelCount) {
+        for (uint32_t i = 0; i < levelCount * arrayLayers; i++) {
+            subresourceStates[i].record(access, true);
+        }
+    }
+
+    VkImageAspectFlags Image::getBarrierAspect() const {
+        // Barriers on depth/stencil images must name both aspects, whatever the view uses
+        if (hasDepthComponent(format)) {
+            return hasStencilComponent(format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+        }
+        return format == VK_FORMAT_S8_UINT ? VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+
     VkImage Image::getImage() const { return image; }
+    VkFormat Image::getFormat() const { return format; }
+    VkExtent2D Image::getExtent() const { return extent; }
+    VkImageTiling Image::getTiling() const { return tiling; }
+    VkImageUsageFlags Image::getUsage() const { return usage; }
+    VkImageAspectFlags Image::getAspect() const { return aspect; }
+    VkMemoryPropertyFlags Image::getMemoryProperties() const { return memProperties; }
+
+    VkExtent2D Image::getLevelExtent(uint32_t mipLevel) const {
+        return {std::max(extent.width >> mipLevel, static_cast<uint32_t>(1)), std::max(extent.height >> mipLevel, static_cast<uint32_t>(1))};
+    }
+
+    uint32_t Image::getMipLevels() const { return mipLevels; }
+    uint32_t Image::getArrayLayers() const { return arrayLayers; }
+
+    bool Image::isConcurrent() const { return queueFamilies.size() > 1; }
+    bool Image::isTransient() const { return (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0; }
+
+    bool Image::isLazilyAllocated() const {
+        return allocation.memory != VK_NULL_HANDLE &&
+               (device.getAllocator().getMemoryTypeProperties(allocation.memoryType) & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+    }
+
     VkImageView Image::getView() const { return imageView; }
-    VkDeviceMemory Image::getMemory() const { return memory; }
+    VkDeviceMemory Image::getMemory() const { return allocation.memory; }
+    const MemoryAllocation &Image::getAllocation() const { return allocation; }
 
     Image::~Image() {
+        // Framebuffers using the view can't outlive it
+        if (imageView != VK_NULL_HANDLE) {
+            device.getFramebufferCache().evictView(imageView);
+        }
         vkDestroyImageView(device.logical, imageView, nullptr);
         vkDestroyImage(device.logical, image, nullptr);
-        vkFreeMemory(device.logical, memory, nullptr);
+        device.getAllocator().free(allocation);
     }
 
 } // namespace HLVulkan
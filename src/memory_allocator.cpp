@@ -0,0 +1,382 @@
+#include "memory_allocator.hpp"
+
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+#include "stats.hpp"
+
+namespace HLVulkan {
+
+    static VkDeviceSize nextPowerOfTwo(VkDeviceSize value) {
+        VkDeviceSize power = 1;
+        while (power < value) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    static uint32_t log2Floor(VkDeviceSize value) {
+        uint32_t order = 0;
+        while (value > 1) {
+            value >>= 1;
+            order++;
+        }
+        return order;
+    }
+
+    // A single VkDeviceMemory object. Non-dedicated blocks are managed as a buddy system where order k covers MIN_ALLOCATION_SIZE << k bytes.
+    struct MemoryBlock {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryType = 0;
+        bool dedicated = false;
+        MemoryAllocator::ResourceType type = MemoryAllocator::ResourceType::LINEAR;
+
+        uint32_t maxOrder = 0;
+        std::vector<std::set<VkDeviceSize>> freeLists;
+        std::unordered_map<VkDeviceSize, uint32_t> allocatedOrders;
+        VkDeviceSize allocatedBytes = 0;
+        VkDeviceSize requestedBytes = 0;
+
+        void *mapped = nullptr;
+        uint32_t mapCount = 0;
+
+        void initBuddy() {
+            maxOrder = log2Floor(size / MemoryAllocator::MIN_ALLOCATION_SIZE);
+            freeLists.resize(maxOrder + 1);
+            freeLists[maxOrder].insert(0);
+        }
+
+        std::optional<VkDeviceSize> allocate(VkDeviceSize bytes) {
+            uint32_t order = log2Floor(nextPowerOfTwo(std::max(bytes, MemoryAllocator::MIN_ALLOCATION_SIZE)) / MemoryAllocator::MIN_ALLOCATION_SIZE);
+            if (order > maxOrder) {
+                return {};
+            }
+
+            // Find the smallest free range that fits
+            uint32_t current = order;
+            while (current <= maxOrder && freeLists[current].empty()) {
+                current++;
+            }
+            if (current > maxOrder) {
+                return {};
+            }
+
+            VkDeviceSize offset = *freeLists[current].begin();
+            freeLists[current].erase(freeLists[current].begin());
+
+            // Split it until it has the requested order, keeping the upper halves free
+            while (current > order) {
+                current--;
+                freeLists[current].insert(offset + (MemoryAllocator::MIN_ALLOCATION_SIZE << current));
+            }
+
+            allocatedOrders[offset] = order;
+            allocatedBytes += MemoryAllocator::MIN_ALLOCATION_SIZE << order;
+            return offset;
+        }
+
+        void free(VkDeviceSize offset) {
+            auto it = allocatedOrders.find(offset);
+            ASSERT_MSG(it != allocatedOrders.end(), "attempting to free non-existent sub-allocation");
+            uint32_t order = it->second;
+            allocatedOrders.erase(it);
+            allocatedBytes -= MemoryAllocator::MIN_ALLOCATION_SIZE << order;
+
+            // Merge with the buddy as long as it is free
+            while (order < maxOrder) {
+                VkDeviceSize buddy = offset ^ (MemoryAllocator::MIN_ALLOCATION_SIZE << order);
+                if (freeLists[order].erase(buddy) == 0) {
+                    break;
+                }
+                offset = std::min(offset, buddy);
+                order++;
+            }
+            freeLists[order].insert(offset);
+        }
+
+        bool empty() const { return dedicated ? requestedBytes == 0 : allocatedOrders.empty(); }
+
+        VkDeviceSize largestFreeRange() const {
+            if (dedicated) {
+                return 0;
+            }
+            for (uint32_t order = maxOrder + 1; order > 0; order--) {
+                if (!freeLists[order - 1].empty()) {
+                    return MemoryAllocator::MIN_ALLOCATION_SIZE << (order - 1);
+                }
+            }
+            return 0;
+        }
+
+        uint32_t freeRangeCount() const {
+            size_t count = 0;
+            for (const auto &freeList : freeLists) {
+                count += freeList.size();
+            }
+            return static_cast<uint32_t>(count);
+        }
+    };
+
+    float MemoryStats::internalFragmentation() const {
+        return allocatedBytes == 0 ? 0.f : 1.f - static_cast<float>(requestedBytes) / static_cast<float>(allocatedBytes);
+    }
+
+    float MemoryStats::externalFragmentation() const {
+        return freeBytes == 0 ? 0.f : 1.f - static_cast<float>(largestFreeRange) / static_cast<float>(freeBytes);
+    }
+
+    MemoryAllocator::MemoryAllocator(std::shared_ptr<const DeviceCapabilities> capabilities, VkDevice logical, VkDeviceSize preferredBlockSize)
+        : capabilities(capabilities), logical(logical), preferredBlockSize(nextPowerOfTwo(std::max(preferredBlockSize, MIN_ALLOCATION_SIZE))),
+          memProperties(capabilities->getMemoryProperties()), bufferImageGranularity(capabilities->getProperties().limits.bufferImageGranularity),
+          nonCoherentAtomSize(capabilities->getProperties().limits.nonCoherentAtomSize) {}
+
+    VkDeviceSize MemoryAllocator::blockSizeFor(uint32_t memoryType) const {
+        // Small heaps (e.g. host visible device local windows) get blocks no bigger than an eighth of the heap
+        VkDeviceSize heapSize = memProperties.memoryHeaps[memProperties.memoryTypes[memoryType].heapIndex].size;
+        VkDeviceSize blockSize = preferredBlockSize;
+        while (blockSize > MIN_ALLOCATION_SIZE && blockSize > heapSize / 8) {
+            blockSize >>= 1;
+        }
+        return blockSize;
+    }
+
+    VkResult MemoryAllocator::createBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated, ResourceType type, MemoryBlock *&block) {
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        VkDeviceMemory memory;
+        HL_VULKAN_STATS_ADD(ALLOCATE_MEMORY_CALLS, 1);
+        VK_CHECK_RET(vkAllocateMemory(logical, &allocInfo, nullptr, &memory));
+
+        auto newBlock = std::make_unique<MemoryBlock>();
+        newBlock->memory = memory;
+        newBlock->size = size;
+        newBlock->memoryType = memoryType;
+        newBlock->dedicated = dedicated;
+        newBlock->type = type;
+        if (!dedicated) {
+            newBlock->initBuddy();
+        }
+
+        block = newBlock.get();
+        blocks.push_back(std::move(newBlock));
+        return VK_SUCCESS;
+    }
+
+    VkResult MemoryAllocator::allocateFromType(const VkMemoryRequirements &requirements, uint32_t memoryType, ResourceType type,
+                                               MemoryAllocation &allocation) {
+
+        VkDeviceSize blockSize = blockSizeFor(memoryType);
+        VkDeviceSize size = std::max(requirements.size, requirements.alignment);
+
+        // Large resources get their own VkDeviceMemory
+        if (size > blockSize / 2) {
+            MemoryBlock *block;
+            VK_CHECK_RET(createBlock(memoryType, requirements.size, true, type, block));
+            block->allocatedBytes = requirements.size;
+            block->requestedBytes = requirements.size;
+            allocation = {block->memory, 0, requirements.size, memoryType, block};
+            return VK_SUCCESS;
+        }
+
+        // Linear and optimal resources only need to be segregated if a granularity page can span more than one buddy
+        if (bufferImageGranularity <= MIN_ALLOCATION_SIZE) {
+            type = ResourceType::LINEAR;
+        }
+
+        for (auto &block : blocks) {
+            if (block->dedicated || block->memoryType != memoryType || block->type != type) {
+                continue;
+            }
+            std::optional<VkDeviceSize> offset = block->allocate(size);
+            if (offset) {
+                block->requestedBytes += requirements.size;
+                allocation = {block->memory, *offset, requirements.size, memoryType, block.get()};
+                return VK_SUCCESS;
+            }
+        }
+
+        // No existing block has room, create a new one
+        MemoryBlock *block;
+        VK_CHECK_RET(createBlock(memoryType, blockSize, false, type, block));
+        std::optional<VkDeviceSize> offset = block->allocate(size);
+        ASSERT_MSG(offset, "fresh memory block cannot fit allocation");
+        block->requestedBytes += requirements.size;
+        allocation = {block->memory, *offset, requirements.size, memoryType, block};
+        return VK_SUCCESS;
+    }
+
+    VkResult MemoryAllocator::allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, ResourceType type,
+                                       MemoryAllocation &allocation, VkMemoryPropertyFlags preferredProperties) {
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        VkResult ret = VK_ERROR_FEATURE_NOT_PRESENT;
+        for (uint32_t memoryType : capabilities->getMemoryTypes(requirements.memoryTypeBits, properties, preferredProperties)) {
+            if ((ret = allocateFromType(requirements, memoryType, type, allocation)) == VK_SUCCESS) {
+                return VK_SUCCESS;
+            }
+        }
+        return ret;
+    }
+
+    void MemoryAllocator::free(MemoryAllocation &allocation) {
+
+        if (allocation.block == nullptr) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        MemoryBlock *block = allocation.block;
+        if (block->dedicated) {
+            block->allocatedBytes = 0;
+            block->requestedBytes = 0;
+        } else {
+            block->free(allocation.offset);
+            block->requestedBytes -= allocation.size;
+        }
+
+        // Give empty blocks back to the driver, but keep one spare block per memory type so that a create/destroy cycle doesn't thrash
+        bool release = block->empty();
+        if (release && !block->dedicated) {
+            release = std::any_of(blocks.begin(), blocks.end(), [block](const std::unique_ptr<MemoryBlock> &b) {
+                return b.get() != block && !b->dedicated && b->memoryType == block->memoryType && b->type == block->type && b->empty();
+            });
+        }
+        if (release) {
+            if (block->mapped) {
+                vkUnmapMemory(logical, block->memory);
+            }
+            vkFreeMemory(logical, block->memory, nullptr);
+            blocks.erase(std::find_if(blocks.begin(), blocks.end(), [block](const std::unique_ptr<MemoryBlock> &b) { return b.get() == block; }));
+        }
+
+        allocation = {};
+    }
+
+    VkResult MemoryAllocator::map(const MemoryAllocation &allocation, void **data) {
+
+        VK_CHECK_NOT_NULL(allocation.memory);
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // The whole block is mapped once, since a VkDeviceMemory cannot be mapped twice
+        MemoryBlock *block = allocation.block;
+        if (block->mapCount == 0) {
+            VK_CHECK_RET(vkMapMemory(logical, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped));
+        }
+        block->mapCount++;
+
+        *data = static_cast<char *>(block->mapped) + allocation.offset;
+        return VK_SUCCESS;
+    }
+
+    void MemoryAllocator::unmap(const MemoryAllocation &allocation) {
+
+        std::lock_guard<std::mutex> lock(mutex);
+        MemoryBlock *block = allocation.block;
+        ASSERT_MSG(block->mapCount != 0, "memory isn't mapped");
+        if (--block->mapCount == 0) {
+            vkUnmapMemory(logical, block->memory);
+            block->mapped = nullptr;
+        }
+    }
+
+    std::optional<VkMappedMemoryRange> MemoryAllocator::mappedRange(const MemoryAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) const {
+
+        if (memProperties.memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+            return {};
+        }
+
+        // Widen the range to whole atoms, without going past the end of the VkDeviceMemory
+        if (size == VK_WHOLE_SIZE) {
+            size = allocation.size - offset;
+        }
+        VkDeviceSize begin = allocation.offset + offset;
+        VkDeviceSize end = begin + size;
+        begin -= begin % nonCoherentAtomSize;
+        end = std::min((end + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize, allocation.block->size);
+
+        VkMappedMemoryRange range = {};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = allocation.memory;
+        range.offset = begin;
+        range.size = end - begin;
+        return range;
+    }
+
+    VkResult MemoryAllocator::flush(const MemoryAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+        std::optional<VkMappedMemoryRange> range = mappedRange(allocation, offset, size);
+        return range ? vkFlushMappedMemoryRanges(logical, 1, &*range) : VK_SUCCESS;
+    }
+
+    VkResult MemoryAllocator::invalidate(const MemoryAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+        std::optional<VkMappedMemoryRange> range = mappedRange(allocation, offset, size);
+        return range ? vkInvalidateMappedMemoryRanges(logical, 1, &*range) : VK_SUCCESS;
+    }
+
+    VkMemoryPropertyFlags MemoryAllocator::getMemoryTypeProperties(uint32_t memoryType) const {
+        ASSERT_MSG(memoryType < memProperties.memoryTypeCount, "invalid memory type");
+        return memProperties.memoryTypes[memoryType].propertyFlags;
+    }
+
+    MemoryStats MemoryAllocator::getStats() const {
+
+        std::lock_guard<std::mutex> lock(mutex);
+        MemoryStats stats;
+        for (const auto &block : blocks) {
+            stats.reservedBytes += block->size;
+            stats.requestedBytes += block->requestedBytes;
+            stats.allocatedBytes += block->allocatedBytes;
+            if (block->dedicated) {
+                stats.dedicatedCount++;
+                stats.allocationCount++;
+            } else {
+                stats.blockCount++;
+                stats.allocationCount += static_cast<uint32_t>(block->allocatedOrders.size());
+                stats.freeBytes += block->size - block->allocatedBytes;
+                stats.largestFreeRange = std::max(stats.largestFreeRange, block->largestFreeRange());
+            }
+        }
+        return stats;
+    }
+
+    std::vector<MemoryBlockStats> MemoryAllocator::getBlockStats() const {
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<MemoryBlockStats> stats;
+        stats.reserve(blocks.size());
+        for (const auto &block : blocks) {
+            uint32_t allocationCount = block->dedicated ? 1 : static_cast<uint32_t>(block->allocatedOrders.size());
+            stats.push_back({block->memoryType, block->dedicated, block->size, block->allocatedBytes, block->largestFreeRange(), allocationCount,
+                             block->freeRangeCount()});
+        }
+        return stats;
+    }
+
+    void MemoryAllocator::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &block : blocks) {
+            ASSERT_MSG(block->empty(), "memory still allocated");
+            if (block->mapped) {
+                vkUnmapMemory(logical, block->memory);
+            }
+            vkFreeMemory(logical, block->memory, nullptr);
+        }
+        blocks.clear();
+    }
+
+    MemoryAllocator::~MemoryAllocator() {
+        for (const auto &block : blocks) {
+            if (block->mapped) {
+                vkUnmapMemory(logical, block->memory);
+            }
+            vkFreeMemory(logical, block->memory, nullptr);
+        }
+    }
+
+} // namespace HLVulkan
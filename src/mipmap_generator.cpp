@@ -0,0 +1,190 @@
+#include "mipmap_generator.hpp"
+
+#include "barrier_batch.hpp"
+
+namespace HLVulkan {
+
+    static const uint32_t WORKGROUP_SIZE = 8;
+    static const uint32_t SETS_PER_POOL = 16;
+    static const std::vector<DescriptorPoolRatio> DESCRIPTOR_RATIOS = {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f},
+                                                                        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f}};
+
+    MipmapGenerator::MipmapGenerator(Device device, const std::string &shaderFile)
+        : device(device), shaderFile(shaderFile), descriptorAllocator(device, SETS_PER_POOL, DESCRIPTOR_RATIOS) {}
+
+    VkResult MipmapGenerator::generate(Image &image, CommandPool &commandPool) {
+
+        VkCommandBuffer commandBuffer = commandPool.beginSingleTimeCommands("MipmapGenerator::generate");
+        VK_CHECK_NOT_NULL(commandBuffer);
+
+        // Own descriptor sets and views, so that the ones of earlier record() calls stay valid
+        DescriptorAllocator allocator(device, SETS_PER_POOL, DESCRIPTOR_RATIOS);
+        std::vector<VkImageView> views;
+        VkResult ret = recordGeneration(commandBuffer, image, allocator, views);
+        VkResult submitted = commandPool.endSingleTimeCommands(commandBuffer);
+
+        // The submission was waited for
+        destroyViews(views);
+        return ret != VK_SUCCESS ? ret : submitted;
+    }
+
+    VkResult MipmapGenerator::record(VkCommandBuffer commandBuffer, Image &image) {
+        return recordGeneration(commandBuffer, image, descriptorAllocator, levelViews);
+    }
+
+    VkResult MipmapGenerator::recordGeneration(VkCommandBuffer commandBuffer, Image &image, DescriptorAllocator &allocator,
+                                               std::vector<VkImageView> &views) {
+        if (image.getMipLevels() == 1) {
+            return VK_SUCCESS;
+        }
+        if (image.supportsBlitMipmaps()) {
+            image.recordGenerateMipmaps(commandBuffer);
+            return VK_SUCCESS;
+        }
+        return recordCompute(commandBuffer, image, allocator, views);
+    }
+
+    VkResult MipmapGenerator::createComputePipeline() {
+
+        if (pipeline != VK_NULL_HANDLE) {
+            return VK_SUCCESS;
+        }
+
+        // Objects created before a failure are kept for the next attempt
+        if (!shader && !(shader = device.getShaderLibrary().load(shaderFile))) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        // Texels are fetched by index, the sampler never filters
+        VkSamplerCreateInfo samplerInfo = {};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        if (sampler == VK_NULL_HANDLE) {
+            VK_CHECK_RET(vkCreateSampler(device.logical, &samplerInfo, nullptr, &sampler));
+        }
+
+        std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        if (setLayout == VK_NULL_HANDLE && (setLayout = device.getDescriptorLayoutCache().getLayout(bindings)) == VK_NULL_HANDLE) {
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+
+        // Extent of the destination level
+        VkPushConstantRange pushConstants = {};
+        pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstants.offset = 0;
+        pushConstants.size = 2 * sizeof(int32_t);
+
+        VkPipelineLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &setLayout;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushConstants;
+        if (pipelineLayout == VK_NULL_HANDLE) {
+            VK_CHECK_RET(vkCreatePipelineLayout(device.logical, &layoutInfo, nullptr, &pipelineLayout));
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = shader->getModule();
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = pipelineLayout;
+        return vkCreateComputePipelines(device.logical, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+    }
+
+    VkResult MipmapGenerator::recordCompute(VkCommandBuffer commandBuffer, Image &image, DescriptorAllocator &allocator,
+                                            std::vector<VkImageView> &views) {
+
+        const uint32_t mipLevels = image.getMipLevels();
+        ASSERT_MSG(image.getArrayLayers() == 1, "compute mipmap generation only supports single layer images");
+        ASSERT_MSG(image.getLayout(0, 0) != VK_IMAGE_LAYOUT_UNDEFINED, "level 0 has no content");
+        ASSERT_MSG((image.getUsage() & (VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT)) == (VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT),
+                   "compute mipmap generation needs SAMPLED and STORAGE usage");
+
+        // The shader writes through a storage image declared without a format
+        if (!device.getCapabilities().getFeatures().shaderStorageImageWriteWithoutFormat) {
+            return VK_ERROR_FEATURE_NOT_PRESENT;
+        }
+        if (!device.getCapabilities().supportsFormat(image.getFormat(), VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+            return VK_ERROR_FORMAT_NOT_SUPPORTED;
+        }
+
+        VK_CHECK_RET(createComputePipeline());
+
+        // One set per generated level, reading the level above it
+        std::vector<VkDescriptorSet> sets(mipLevels - 1);
+        for (VkDescriptorSet &set : sets) {
+            VK_CHECK_RET(allocator.allocate(setLayout, set));
+        }
+
+        std::vector<VkImageView> levels(mipLevels);
+        for (uint32_t mipLevel = 0; mipLevel < mipLevels; mipLevel++) {
+            VK_CHECK_RET(Image::createImageView(device.logical, image.getImage(), image.getFormat(), VK_IMAGE_ASPECT_COLOR_BIT, levels[mipLevel], mipLevel, 1));
+            views.push_back(levels[mipLevel]);
+        }
+
+        DescriptorWriter writer;
+        for (uint32_t mipLevel = 1; mipLevel < mipLevels; mipLevel++) {
+            writer.writeImage(sets[mipLevel - 1], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, levels[mipLevel - 1], sampler);
+            writer.writeImage(sets[mipLevel - 1], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, levels[mipLevel], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+        }
+        writer.update(device.logical);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+        BarrierBatch barriers;
+        for (uint32_t mipLevel = 1; mipLevel < mipLevels; mipLevel++) {
+            ResourceAccess read = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            ResourceAccess write = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL};
+            barriers.transition(image, read, mipLevel - 1, 1);
+            barriers.transition(image, write, mipLevel, 1);
+            barriers.record(commandBuffer);
+
+            VkExtent2D extent = image.getLevelExtent(mipLevel);
+            int32_t dstExtent[2] = {static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height)};
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &sets[mipLevel - 1], 0, nullptr);
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(dstExtent), dstExtent);
+            vkCmdDispatch(commandBuffer, (extent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (extent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+        }
+
+        barriers.transition(image, ResourceAccess::forLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+        barriers.record(commandBuffer);
+        return VK_SUCCESS;
+    }
+
+    void MipmapGenerator::destroyViews(std::vector<VkImageView> &views) {
+        for (VkImageView view : views) {
+            vkDestroyImageView(device.logical, view, nullptr);
+        }
+        views.clear();
+    }
+
+    void MipmapGenerator::reset() {
+        descriptorAllocator.reset();
+        destroyViews(levelViews);
+    }
+
+    MipmapGenerator::~MipmapGenerator() {
+        reset();
+        vkDestroyPipeline(device.logical, pipeline, nullptr);
+        vkDestroyPipelineLayout(device.logical, pipelineLayout, nullptr);
+        vkDestroySampler(device.logical, sampler, nullptr);
+    }
+
+} // namespace HLVulkan
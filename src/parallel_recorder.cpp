@@ -0,0 +1,109 @@
+#include "parallel_recorder.hpp"
+
+#include <algorithm>
+
+namespace HLVulkan {
+
+    ParallelRecorder::ParallelRecorder(Device device, Queue queue, uint32_t framesInFlight, size_t threadCount)
+        : device(device), queue(queue), framesInFlight(framesInFlight), workers(threadCount) {
+
+        ASSERT_MSG(framesInFlight != 0, "framesInFlight must be strictly positive");
+
+        // Secondaries are re-recorded every frame, so the pools only need to be reset as a whole
+        const size_t poolsPerFrame = workers.getThreadCount() + 1;
+        for (size_t i = 0; i < framesInFlight * poolsPerFrame; i++) {
+            pools.push_back(std::make_unique<CommandPool>(device, queue, 0, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT));
+        }
+    }
+
+    CommandPool &ParallelRecorder::getPool(uint32_t slot, size_t index) { return *pools[slot * (workers.getThreadCount() + 1) + index]; }
+
+    VkResult ParallelRecorder::beginFrame(uint32_t frameIndex) {
+        frameSlot = frameIndex % framesInFlight;
+        for (size_t i = 0; i <= workers.getThreadCount(); i++) {
+            VK_CHECK_RET(getPool(frameSlot, i).reset());
+        }
+        return VK_SUCCESS;
+    }
+
+    VkCommandBuffer ParallelRecorder::beginPrimary() {
+
+        VkCommandBuffer commandBuffer = getPool(frameSlot, workers.getThreadCount()).acquireCommandBuffer();
+        if (commandBuffer == VK_NULL_HANDLE) {
+            return VK_NULL_HANDLE;
+        }
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        VK_CHECK_RET_NULL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+        return commandBuffer;
+    }
+
+    VkResult ParallelRecorder::recordSecondaries(VkCommandBuffer primary, const VkCommandBufferInheritanceInfo &inheritance, size_t jobCount,
+                                                 const RecordFunction &record) {
+
+        if (jobCount == 0) {
+            return VK_SUCCESS;
+        }
+
+        // Contiguous ranges of jobs per worker, each worker owning its pool for the whole call
+        const size_t chunkCount = std::min(jobCount, workers.getThreadCount());
+        std::vector<VkCommandBuffer> secondaries(jobCount, VK_NULL_HANDLE);
+        std::vector<std::future<VkResult>> results;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            const size_t first = jobCount * chunk / chunkCount;
+            const size_t last = jobCount * (chunk + 1) / chunkCount;
+            CommandPool *pool = &getPool(frameSlot, chunk);
+
+            results.push_back(workers.submit([=, &inheritance, &record, &secondaries]() {
+                VkCommandBufferBeginInfo beginInfo = {};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                if (inheritance.renderPass != VK_NULL_HANDLE) {
+                    beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+                }
+                beginInfo.pInheritanceInfo = &inheritance;
+
+                for (size_t index = first; index < last; index++) {
+                    VkCommandBuffer commandBuffer = pool->acquireCommandBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+                    if (commandBuffer == VK_NULL_HANDLE) {
+                        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+                    }
+                    VK_CHECK_RET(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+                    record(commandBuffer, index);
+                    VK_CHECK_RET(vkEndCommandBuffer(commandBuffer));
+                    secondaries[index] = commandBuffer;
+                }
+                return VK_SUCCESS;
+            }));
+        }
+
+        // Every job must be done before returning, they reference the caller's arguments
+        VkResult ret = VK_SUCCESS;
+        for (auto &result : results) {
+            VkResult chunkResult = result.get();
+            if (chunkResult != VK_SUCCESS && ret == VK_SUCCESS) {
+                ret = chunkResult;
+            }
+        }
+        VK_CHECK_RET(ret);
+
+        vkCmdExecuteCommands(primary, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+        return VK_SUCCESS;
+    }
+
+    VkResult ParallelRecorder::recordSecondaries(VkCommandBuffer primary, VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer,
+                                                 size_t jobCount, const RecordFunction &record) {
+        VkCommandBufferInheritanceInfo inheritance = {};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = renderPass;
+        inheritance.subpass = subpass;
+        inheritance.framebuffer = framebuffer;
+        return recordSecondaries(primary, inheritance, jobCount, record);
+    }
+
+    size_t ParallelRecorder::getThreadCount() const { return workers.getThreadCount(); }
+
+} // namespace HLVulkan
@@ -1,20 +1,326 @@
 #include "pipeline_factory.hpp"
 
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+
 namespace HLVulkan {
 
-    PipelineFactory::PipelineFactory(HLVulkan::Device &device) : device(device) {}
+    // The header fields of a pipeline cache are always stored least significant byte first
+    static uint32_t readLittleEndian(const char *data) {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+        return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 | static_cast<uint32_t>(bytes[2]) << 16 |
+               static_cast<uint32_t>(bytes[3]) << 24;
+    }
+
+    static bool isCacheCompatible(const std::vector<char> &data, const VkPhysicalDeviceProperties &properties) {
+
+        const size_t headerSize = 16 + VK_UUID_SIZE;
+        if (data.size() < headerSize) {
+            return false;
+        }
+
+        return readLittleEndian(&data[0]) >= headerSize && readLittleEndian(&data[4]) == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+               readLittleEndian(&data[8]) == properties.vendorID && readLittleEndian(&data[12]) == properties.deviceID &&
+               memcmp(&data[16], properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    PipelineFactory::PipelineFactory(HLVulkan::Device &device, const std::string &cacheFile, bool driverFeedback, size_t workerCount)
+        : device(device), cacheFile(cacheFile), driverFeedback(driverFeedback), workerCount(workerCount) {
+
+        std::vector<char> initialData = loadCacheData();
+
+        VkPipelineCacheCreateInfo cacheInfo = {};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = initialData.size();
+        cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+        VK_CHECK_FAIL(vkCreatePipelineCache(device.logical, &cacheInfo, nullptr, &pipelineCache), "pipeline cache creation failed");
+    }
+
+    std::vector<char> PipelineFactory::loadCacheData() {
+
+        std::vector<char> data;
+        if (cacheFile.empty()) {
+            return data;
+        }
+
+        std::ifstream file(cacheFile, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            return data;
+        }
+        data.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(data.data(), data.size());
+
+        if (!file) {
+            std::cout << "discarding pipeline cache " << cacheFile << ": file can't be read" << std::endl;
+            data.clear();
+        }
+
+        // An empty file is no blob at all. Drivers are supposed to reject stale blobs themselves, but not all of them do it gracefully.
+        if (!data.empty() && !isCacheCompatible(data, device.getCapabilities().getProperties())) {
+            std::cout << "discarding pipeline cache " << cacheFile << ": written by another device or driver" << std::endl;
+            cacheStats.loadRejected = true;
+            data.clear();
+        }
+
+        cacheStats.loadedBytes = data.size();
+        return data;
+    }
+
+    VkResult PipelineFactory::saveCache() {
+
+        ASSERT_MSG(!cacheFile.empty(), "pipeline factory has no cache file");
+
+        size_t size;
+        VK_CHECK_RET(vkGetPipelineCacheData(device.logical, pipelineCache, &size, nullptr));
+        std::vector<char> data(size);
+        VK_CHECK_RET(vkGetPipelineCacheData(device.logical, pipelineCache, &size, data.data()));
+
+        return writeFileAtomically(cacheFile, data.data(), size) ? VK_SUCCESS : VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    void PipelineFactory::recordFeedback(const PipelineCreationFeedback &feedback) {
+        cacheStats.pipelinesCreated++;
+        cacheStats.creationTimeNs += feedback.durationNs;
+        if (feedback.valid) {
+            feedback.cacheHit ? cacheStats.cacheHits++ : cacheStats.cacheMisses++;
+        }
+    }
+
+    VkPipelineCache PipelineFactory::getPipelineCache() const { return pipelineCache; }
+
+    PipelineCacheStats PipelineFactory::getCacheStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cacheStats;
+    }
+
+    WorkerPool &PipelineFactory::getWorkerPool() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!workers) {
+            workers = std::make_unique<WorkerPool>(workerCount);
+        }
+        return *workers;
+    }
+
+    VkResult PipelineFactory::createPipelineLayout(const HLVulkan::Device &device, const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                                   VkPipelineLayout &layout) {
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+
+        return vkCreatePipelineLayout(device.logical, &pipelineLayoutInfo, nullptr, &layout);
+    }
 
-    void PipelineFactory::addPipelineToSet(PipelineInfo &info) { createdPipelines.insert(info); }
+    VkPipelineLayout PipelineFactory::acquireLayout(const std::vector<VkDescriptorSetLayout> &setLayouts) {
+
+        StateKey key;
+        key.add(setLayouts);
+
+        auto it = layoutsByKey.find(key);
+        if (it != layoutsByKey.end()) {
+            layouts.at(it->second).refCount++;
+            return it->second;
+        }
+
+        VkPipelineLayout layout;
+        if (createPipelineLayout(device, setLayouts, layout) != VK_SUCCESS) {
+            return VK_NULL_HANDLE;
+        }
+        layoutsByKey.emplace(key, layout);
+        layouts.emplace(layout, LayoutRecord{1, key});
+        return layout;
+    }
+
+    void PipelineFactory::releaseLayout(VkPipelineLayout layout) {
+        auto it = layouts.find(layout);
+        ASSERT_MSG(it != layouts.end(), "attempting to release non-existent pipeline layout");
+
+        if (it != layouts.end() && --it->second.refCount == 0) {
+            layoutsByKey.erase(it->second.key);
+            layouts.erase(it);
+            vkDestroyPipelineLayout(device.logical, layout, nullptr);
+        }
+    }
+
+    static bool hasDynamicState(const std::vector<VkDynamicState> &states, VkDynamicState state) {
+        return std::binary_search(states.begin(), states.end(), state);
+    }
+
+    static VkPrimitiveTopology getTopologyClass(VkPrimitiveTopology topology) {
+        switch (topology) {
+        case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+            return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+            return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+        case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+            return VK_PRIMITIVE_TOPOLOGY_PATCH_LIST;
+        default:
+            return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        }
+    }
+
+    std::vector<VkDynamicState> PipelineFactory::getSupportedDynamicStates(const HLVulkan::Device &device, const std::vector<VkDynamicState> &states) {
+        // Supporting the extension isn't enough, the application must have enabled it (and its feature) on the device
+        const bool extended =
+            device.getCapabilities().supportsExtendedDynamicState() && device.isExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+
+        std::vector<VkDynamicState> supported;
+        for (VkDynamicState state : states) {
+            if (extended || state < VK_DYNAMIC_STATE_CULL_MODE_EXT || state > VK_DYNAMIC_STATE_STENCIL_OP_EXT) {
+                supported.push_back(state);
+            }
+        }
+        std::sort(supported.begin(), supported.end());
+        supported.erase(std::unique(supported.begin(), supported.end()), supported.end());
+        return supported;
+    }
+
+    void PipelineFactory::clearDynamicViewports(const std::vector<VkDynamicState> &states, VkPipelineViewportStateCreateInfo &viewportState) {
+        if (hasDynamicState(states, VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT_EXT)) {
+            viewportState.viewportCount = 0;
+            viewportState.pViewports = nullptr;
+        } else if (hasDynamicState(states, VK_DYNAMIC_STATE_VIEWPORT)) {
+            viewportState.viewportCount = std::max(viewportState.viewportCount, 1u);
+            viewportState.pViewports = nullptr;
+        }
+
+        if (hasDynamicState(states, VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT_EXT)) {
+            viewportState.scissorCount = 0;
+            viewportState.pScissors = nullptr;
+        } else if (hasDynamicState(states, VK_DYNAMIC_STATE_SCISSOR)) {
+            viewportState.scissorCount = std::max(viewportState.scissorCount, 1u);
+            viewportState.pScissors = nullptr;
+        }
+    }
+
+    void PipelineFactory::clearDynamicFields(const std::vector<VkDynamicState> &states, VkVertexInputBindingDescription &binding,
+                                             VkPipelineInputAssemblyStateCreateInfo &inputAssembly, VkPipelineRasterizationStateCreateInfo &rasterizer,
+                                             VkPipelineDepthStencilStateCreateInfo &depthStencil) {
+        for (VkDynamicState state : states) {
+            switch (state) {
+            case VK_DYNAMIC_STATE_LINE_WIDTH:
+                rasterizer.lineWidth = 0.f;
+                break;
+            case VK_DYNAMIC_STATE_DEPTH_BIAS:
+                rasterizer.depthBiasConstantFactor = 0.f;
+                rasterizer.depthBiasClamp = 0.f;
+                rasterizer.depthBiasSlopeFactor = 0.f;
+                break;
+            case VK_DYNAMIC_STATE_DEPTH_BOUNDS:
+                depthStencil.minDepthBounds = 0.f;
+                depthStencil.maxDepthBounds = 0.f;
+                break;
+            case VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK:
+                depthStencil.front.compareMask = depthStencil.back.compareMask = 0;
+                break;
+            case VK_DYNAMIC_STATE_STENCIL_WRITE_MASK:
+                depthStencil.front.writeMask = depthStencil.back.writeMask = 0;
+                break;
+            case VK_DYNAMIC_STATE_STENCIL_REFERENCE:
+                depthStencil.front.reference = depthStencil.back.reference = 0;
+                break;
+            case VK_DYNAMIC_STATE_CULL_MODE_EXT:
+                rasterizer.cullMode = VK_CULL_MODE_NONE;
+                break;
+            case VK_DYNAMIC_STATE_FRONT_FACE_EXT:
+                rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+                break;
+            case VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT:
+                inputAssembly.topology = getTopologyClass(inputAssembly.topology);
+                break;
+            case VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE_EXT:
+                binding.stride = 0;
+                break;
+            case VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT:
+                depthStencil.depthTestEnable = VK_FALSE;
+                break;
+            case VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT:
+                depthStencil.depthWriteEnable = VK_FALSE;
+                break;
+            case VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT:
+                depthStencil.depthCompareOp = VK_COMPARE_OP_NEVER;
+                break;
+            case VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE_EXT:
+                depthStencil.depthBoundsTestEnable = VK_FALSE;
+                break;
+            case VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT:
+                depthStencil.stencilTestEnable = VK_FALSE;
+                break;
+            case VK_DYNAMIC_STATE_STENCIL_OP_EXT:
+                for (VkStencilOpState *face : {&depthStencil.front, &depthStencil.back}) {
+                    face->failOp = face->passOp = face->depthFailOp = VK_STENCIL_OP_KEEP;
+                    face->compareOp = VK_COMPARE_OP_NEVER;
+                }
+                break;
+            default:
+                // Viewports and scissors are handled by clearDynamicViewports(), blend constants aren't part of the spec
+                break;
+            }
+        }
+    }
+
+    std::optional<PipelineInfo> PipelineFactory::referencePipeline(const StateKey &key) {
+        auto it = pipelinesByKey.find(key);
+        if (it == pipelinesByKey.end()) {
+            return std::nullopt;
+        }
+        PipelineRecord &record = pipelines.at(it->second);
+        record.refCount++;
+        return record.info;
+    }
+
+    PipelineInfo PipelineFactory::addPipeline(const PipelineInfo &info, const std::optional<StateKey> &key) {
+        if (key) {
+            // Another thread may have compiled the same state in the meantime, keep the first one
+            std::optional<PipelineInfo> existing = referencePipeline(*key);
+            if (existing) {
+                vkDestroyPipeline(device.logical, info.pipeline, nullptr);
+                releaseLayout(info.layout);
+                return *existing;
+            }
+            pipelinesByKey.emplace(*key, info.pipeline);
+        }
+        pipelines.emplace(info.pipeline, PipelineRecord{info, 1, key});
+        return info;
+    }
 
     void PipelineFactory::destroyPipeline(VkPipeline pipeline) {
-        ASSERT_MSG(createdPipelines.erase(PipelineInfo{pipeline, VK_NULL_HANDLE}) == 1, "attempting to delete non-existent pipeline");
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pipelines.find(pipeline);
+        ASSERT_MSG(it != pipelines.end(), "attempting to delete non-existent pipeline");
+
+        if (it != pipelines.end() && --it->second.refCount == 0) {
+            VkPipelineLayout layout = it->second.info.layout;
+            if (it->second.key) {
+                pipelinesByKey.erase(*it->second.key);
+            }
+            pipelines.erase(it);
+            vkDestroyPipeline(device.logical, pipeline, nullptr);
+            releaseLayout(layout);
+        }
     }
 
     PipelineFactory::~PipelineFactory() {
-        for (const auto &pipelineInfo : createdPipelines) {
-            vkDestroyPipeline(device.logical, pipelineInfo.pipeline, nullptr);
-            vkDestroyPipelineLayout(device.logical, pipelineInfo.layout, nullptr);
+        // Finish the batches still queued before tearing anything down
+        workers.reset();
+
+        for (const auto &pipeline : pipelines) {
+            vkDestroyPipeline(device.logical, pipeline.first, nullptr);
+        }
+        for (const auto &layout : layouts) {
+            vkDestroyPipelineLayout(device.logical, layout.first, nullptr);
+        }
+
+        if (!cacheFile.empty() && saveCache() != VK_SUCCESS) {
+            std::cout << "failed to save pipeline cache to " << cacheFile << std::endl;
         }
+        vkDestroyPipelineCache(device.logical, pipelineCache, nullptr);
     }
 
-} // namespace HLVulkan
\ No newline at end of file
+} // namespace HLVulkan
@@ -1,7 +1,10 @@
 #include "pipeline_spec.hpp"
 
+#include "device.hpp"
+
 namespace HLVulkan {
 
+    std::vector<ShaderStage> PipelineSpec::getShaderStages() const { return createShaderStages(); }
     VkPipelineInputAssemblyStateCreateInfo PipelineSpec::getInputAssembly() const { return createInputAssembly(); }
     std::vector<VkViewport> PipelineSpec::getViewports() const { return createViewports(); }
     std::vector<VkRect2D> PipelineSpec::getScissors() const { return createScissors(); }
@@ -9,7 +12,32 @@ namespace HLVulkan {
     VkPipelineMultisampleStateCreateInfo PipelineSpec::getMultisampling() const { return createMultisampling(); }
     std::vector<VkPipelineColorBlendAttachmentState> PipelineSpec::getColorBlending() const { return createColorBlending(); }
     std::vector<VkDescriptorSetLayout> PipelineSpec::getDescriptorSetLayouts() const { return createDescriptorSetLayouts(); }
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> PipelineSpec::getDescriptorSetBindings() const { return createDescriptorSetBindings(); }
     VkPipelineDepthStencilStateCreateInfo PipelineSpec::getDepthStencil() const { return createDepthStencil(); }
+    std::vector<VkDynamicState> PipelineSpec::getDynamicStates() const { return createDynamicStates(); }
+
+    std::vector<ShaderStage> PipelineSpec::createShaderStages() const {
+        return {{"../data/shaders/vk_vert.spv", VK_SHADER_STAGE_VERTEX_BIT}, {"../data/shaders/vk_frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT}};
+    }
+
+    std::vector<VkDescriptorSetLayout> PipelineSpec::getDescriptorSetLayouts(const Device &device) const {
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets = getDescriptorSetBindings();
+        if (sets.empty()) {
+            return getDescriptorSetLayouts();
+        }
+
+        std::vector<VkDescriptorSetLayout> layouts;
+        for (const auto &bindings : sets) {
+            layouts.push_back(device.getDescriptorLayoutCache().getLayout(bindings));
+        }
+        return layouts;
+    }
+
+    std::vector<VkDescriptorSetLayout> PipelineSpec::createDescriptorSetLayouts() const { return {}; }
+
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> PipelineSpec::createDescriptorSetBindings() const { return {}; }
+
+    std::vector<VkDynamicState> PipelineSpec::createDynamicStates() const { return {}; }
 
     PipelineSpec::~PipelineSpec() {}
 
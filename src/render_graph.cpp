@@ -0,0 +1,517 @@
+#include "render_graph.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include "barrier_batch.hpp"
+#include "render_pass_spec.hpp"
+
+namespace HLVulkan {
+
+    namespace {
+
+        // Single subpass render pass derived from the attachments of a raster pass. Attachments keep their layout across the render pass, the
+        // graph transitions them with barriers beforehand, so no subpass dependency is needed either.
+        class GraphRenderPassSpec : public RenderPassSpec {
+
+          public:
+            std::vector<VkAttachmentDescription> attachments;
+            std::vector<VkAttachmentReference> colorReferences;
+            std::optional<VkAttachmentReference> depthReference;
+
+          private:
+            std::vector<VkAttachmentDescription> createAttachments() const override { return attachments; }
+
+            std::vector<VkSubpassDescription> createSubpasses() const override {
+                VkSubpassDescription subpass = {};
+                subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+                subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+                subpass.pColorAttachments = colorReferences.data();
+                subpass.pDepthStencilAttachment = depthReference ? &*depthReference : nullptr;
+                return {subpass};
+            }
+
+            std::vector<VkSubpassDependency> createDependencies() const override { return {}; }
+        };
+
+    } // namespace
+
+    RenderGraph::PassBuilder::PassBuilder(RenderGraph &graph, PassId pass) : graph(graph), pass(pass) {}
+
+    RenderGraph::PassBuilder &RenderGraph::PassBuilder::read(ResourceId resource, const ResourceAccess &access) {
+        graph.addAccess(pass, resource, access, AccessType::READ, std::nullopt);
+        return *this;
+    }
+
+    RenderGraph::PassBuilder &RenderGraph::PassBuilder::write(ResourceId resource, const ResourceAccess &access) {
+        graph.addAccess(pass, resource, access, AccessType::WRITE, std::nullopt);
+        return *this;
+    }
+
+    RenderGraph::PassBuilder &RenderGraph::PassBuilder::colorAttachment(ResourceId image, std::optional<VkClearColorValue> clear) {
+        std::optional<VkClearValue> clearValue;
+        if (clear) {
+            clearValue = VkClearValue{};
+            clearValue->color = *clear;
+        }
+        graph.addAccess(pass, image, ResourceAccess::forLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL), AccessType::ATTACHMENT, clearValue);
+        return *this;
+    }
+
+    RenderGraph::PassBuilder &RenderGraph::PassBuilder::depthAttachment(ResourceId image, std::optional<VkClearDepthStencilValue> clear) {
+        std::optional<VkClearValue> clearValue;
+        if (clear) {
+            clearValue = VkClearValue{};
+            clearValue->depthStencil = *clear;
+        }
+        graph.addAccess(pass, image, ResourceAccess::forLayout(VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL), AccessType::ATTACHMENT, clearValue);
+        return *this;
+    }
+
+    RenderGraph::PassBuilder &RenderGraph::PassBuilder::sideEffect() {
+        graph.passes[pass].sideEffect = true;
+        return *this;
+    }
+
+    RenderGraph::RenderGraph(Device device, uint32_t framesInFlight) : device(device), renderPassFactory(this->device), framesInFlight(framesInFlight) {}
+
+    RenderGraph::ResourceId RenderGraph::importImage(Image &image) {
+        Resource resource;
+        resource.image = &image;
+        resources.push_back(std::move(resource));
+        compiled = false;
+        return static_cast<ResourceId>(resources.size() - 1);
+    }
+
+    RenderGraph::ResourceId RenderGraph::importBuffer(Buffer &buffer) {
+        Resource resource;
+        resource.buffer = &buffer;
+        resources.push_back(std::move(resource));
+        compiled = false;
+        return static_cast<ResourceId>(resources.size() - 1);
+    }
+
+    RenderGraph::ResourceId RenderGraph::createImage(const RenderGraphImageDesc &desc) {
+        Resource resource;
+        resource.desc = desc;
+        resources.push_back(std::move(resource));
+        compiled = false;
+        return static_cast<ResourceId>(resources.size() - 1);
+    }
+
+    RenderGraph::PassId RenderGraph::addPass(const std::string &name, const std::function<void(PassBuilder &builder)> &setup,
+                                             const ExecuteFunction &execute) {
+        Pass pass;
+        pass.name = name;
+        pass.execute = execute;
+        passes.push_back(std::move(pass));
+        compiled = false;
+
+        PassBuilder builder(*this, static_cast<PassId>(passes.size() - 1));
+        setup(builder);
+        return builder.pass;
+    }
+
+    void RenderGraph::addAccess(PassId pass, ResourceId resource, const ResourceAccess &access, AccessType type, std::optional<VkClearValue> clear) {
+        ASSERT_MSG(resource < resources.size(), "unknown render graph resource");
+        ASSERT_MSG(type != AccessType::ATTACHMENT || resources[resource].buffer == nullptr, "buffers can't be attachments");
+        passes[pass].accesses.push_back({resource, access, type, clear});
+    }
+
+    void RenderGraph::cull(const std::vector<std::vector<PassId>> &producers) {
+
+        // Passes whose results outlive the graph, and everything they read from
+        std::vector<PassId> stack;
+        for (PassId pass = 0; pass < passes.size(); pass++) {
+            passes[pass].culled = true;
+            bool root = passes[pass].sideEffect;
+            for (const Access &access : passes[pass].accesses) {
+                root |= access.type != AccessType::READ && !resources[access.resource].desc;
+            }
+            if (root) {
+                stack.push_back(pass);
+            }
+        }
+
+        while (!stack.empty()) {
+            PassId pass = stack.back();
+            stack.pop_back();
+            if (passes[pass].culled) {
+                passes[pass].culled = false;
+                stack.insert(stack.end(), producers[pass].begin(), producers[pass].end());
+            }
+        }
+    }
+
+    void RenderGraph::sortPasses(const std::vector<std::vector<PassId>> &dependencies) {
+
+        std::vector<std::vector<PassId>> dependents(passes.size());
+        std::vector<uint32_t> remaining(passes.size(), 0);
+        std::set<PassId> ready;
+        for (PassId pass = 0; pass < passes.size(); pass++) {
+            if (passes[pass].culled) {
+                continue;
+            }
+            for (PassId dependency : dependencies[pass]) {
+                dependents[dependency].push_back(pass);
+            }
+            remaining[pass] = static_cast<uint32_t>(dependencies[pass].size());
+            if (remaining[pass] == 0) {
+                ready.insert(pass);
+            }
+        }
+
+        while (!ready.empty()) {
+            // Prefer a pass that doesn't depend on the one just scheduled, so that the barrier between them has other work to overlap with
+            auto next = ready.begin();
+            if (!order.empty()) {
+                const std::vector<PassId> &previousDependents = dependents[order.back()];
+                auto independent = std::find_if(ready.begin(), ready.end(), [&previousDependents](PassId pass) {
+                    return std::find(previousDependents.begin(), previousDependents.end(), pass) == previousDependents.end();
+                });
+                if (independent != ready.end()) {
+                    next = independent;
+                }
+            }
+
+            PassId pass = *next;
+            ready.erase(next);
+            order.push_back(pass);
+            for (PassId dependent : dependents[pass]) {
+                if (--remaining[dependent] == 0) {
+                    ready.insert(dependent);
+                }
+            }
+        }
+    }
+
+    VkResult RenderGraph::allocateTransients() {
+
+        // Lifetimes in execution order, and the scope of every access to each image
+        std::vector<bool> used(resources.size(), false);
+        std::vector<VkPipelineStageFlags> stages(resources.size(), 0);
+        std::vector<VkAccessFlags> writeAccess(resources.size(), 0);
+        for (uint32_t position = 0; position < order.size(); position++) {
+            for (const Access &access : passes[order[position]].accesses) {
+                Resource &resource = resources[access.resource];
+                if (!resource.desc) {
+                    continue;
+                }
+                if (!used[access.resource]) {
+                    used[access.resource] = true;
+                    resource.firstUse = position;
+                }
+                resource.lastUse = position;
+                stages[access.resource] |= access.access.stages;
+                writeAccess[access.resource] |= access.access.isWrite() ? access.access.access : 0;
+            }
+        }
+
+        std::vector<std::pair<ResourceId, VkMemoryRequirements>> transients;
+        for (ResourceId id = 0; id < resources.size(); id++) {
+            if (used[id]) {
+                const RenderGraphImageDesc &desc = *resources[id].desc;
+                VkMemoryRequirements requirements;
+                VK_CHECK_RET(Image::getMemoryRequirements(device.logical, desc.extent, desc.format, VK_IMAGE_TILING_OPTIMAL, desc.usage, requirements));
+                transients.emplace_back(id, requirements);
+                requestedSize += requirements.size;
+            }
+        }
+
+        // Largest first, each image goes to the first slot it is compatible with and that is free for its whole lifetime
+        std::stable_sort(transients.begin(), transients.end(), [](const auto &a, const auto &b) { return a.second.size > b.second.size; });
+        for (const auto &transient : transients) {
+            Resource &resource = resources[transient.first];
+            const VkMemoryRequirements &requirements = transient.second;
+            const bool lazy = (resource.desc->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+
+            auto slot = std::find_if(slots.begin(), slots.end(), [&](const MemorySlot &slot) {
+                return slot.lazy == lazy && (slot.requirements.memoryTypeBits & requirements.memoryTypeBits) != 0 &&
+                       std::none_of(slot.lifetimes.begin(), slot.lifetimes.end(), [&resource](const std::pair<uint32_t, uint32_t> &lifetime) {
+                           return resource.firstUse <= lifetime.second && lifetime.first <= resource.lastUse;
+                       });
+            });
+            if (slot == slots.end()) {
+                slots.push_back({requirements, {}, lazy, {}});
+                slot = slots.end() - 1;
+            } else {
+                slot->requirements.size = std::max(slot->requirements.size, requirements.size);
+                slot->requirements.alignment = std::max(slot->requirements.alignment, requirements.alignment);
+                slot->requirements.memoryTypeBits &= requirements.memoryTypeBits;
+            }
+            slot->lifetimes.emplace_back(resource.firstUse, resource.lastUse);
+            slot->stages |= stages[transient.first];
+            slot->writeAccess |= writeAccess[transient.first];
+            resource.slot = static_cast<uint32_t>(slot - slots.begin());
+        }
+
+        for (MemorySlot &slot : slots) {
+            VK_CHECK_RET(device.getAllocator().allocate(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryAllocator::ResourceType::OPTIMAL,
+                                                        slot.allocation, slot.lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0));
+        }
+        for (const auto &transient : transients) {
+            Resource &resource = resources[transient.first];
+            const RenderGraphImageDesc &desc = *resource.desc;
+            resource.transient = std::make_unique<Image>(device, desc.extent, desc.format, VK_IMAGE_TILING_OPTIMAL, desc.usage, desc.aspect,
+                                                         slots[resource.slot].allocation);
+        }
+        return VK_SUCCESS;
+    }
+
+    VkRenderPass RenderGraph::createRenderPass(const Pass &pass, uint32_t position) {
+
+        GraphRenderPassSpec spec;
+        std::vector<const Image *> images;
+        for (const Access &access : pass.accesses) {
+            if (access.type != AccessType::ATTACHMENT) {
+                continue;
+            }
+
+            // Content is only loaded if an earlier pass produced it, and only stored if a later pass uses it
+            const Resource &resource = resources[access.resource];
+            const bool previous = !resource.desc || resource.firstUse < position;
+            const bool later = !resource.desc || resource.lastUse > position;
+            const Image &image = getImage(access.resource);
+
+            VkAttachmentDescription attachment = {};
+            attachment.format = image.getFormat();
+            attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            attachment.loadOp = access.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : previous ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.storeOp = later ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.stencilLoadOp = hasStencilComponent(attachment.format) ? attachment.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = hasStencilComponent(attachment.format) ? attachment.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = access.access.layout;
+            attachment.finalLayout = access.access.layout;
+
+            VkAttachmentReference reference = {static_cast<uint32_t>(spec.attachments.size()), access.access.layout};
+            if (access.access.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
+                ASSERT_MSG(!spec.depthReference, "more than one depth attachment");
+                spec.depthReference = reference;
+            } else {
+                spec.colorReferences.push_back(reference);
+            }
+            spec.attachments.push_back(attachment);
+            images.push_back(&image);
+        }
+
+        // A transient image whose content is used across passes can't stay on chip
+        if (spec.attachments.empty() || !spec.checkTransientAttachments(images)) {
+            return VK_NULL_HANDLE;
+        }
+        return renderPassFactory.generateNewRenderPass(spec);
+    }
+
+    VkResult RenderGraph::compile() {
+
+        release();
+
+        // Producers of what each pass reads, in declaration order. An attachment without a clear value reads the previous content.
+        std::vector<std::vector<PassId>> producers(passes.size());
+        std::vector<std::optional<PassId>> lastWriter(resources.size());
+        for (PassId pass = 0; pass < passes.size(); pass++) {
+            for (const Access &access : passes[pass].accesses) {
+                const bool reads = access.type == AccessType::READ || (access.type == AccessType::ATTACHMENT && !access.clear);
+                if (reads && lastWriter[access.resource] && *lastWriter[access.resource] != pass) {
+                    producers[pass].push_back(*lastWriter[access.resource]);
+                }
+            }
+            for (const Access &access : passes[pass].accesses) {
+                if (access.type != AccessType::READ) {
+                    lastWriter[access.resource] = pass;
+                }
+            }
+        }
+        cull(producers);
+
+        // Every hazard (read after write, write after read or write) between the passes left, which must keep their relative order
+        std::vector<std::vector<PassId>> dependencies(passes.size());
+        std::vector<std::vector<PassId>> accessors(resources.size());
+        lastWriter.assign(resources.size(), std::nullopt);
+        for (PassId pass = 0; pass < passes.size(); pass++) {
+            if (passes[pass].culled) {
+                continue;
+            }
+            std::vector<PassId> &passDependencies = dependencies[pass];
+            for (const Access &access : passes[pass].accesses) {
+                if (access.type != AccessType::READ) {
+                    passDependencies.insert(passDependencies.end(), accessors[access.resource].begin(), accessors[access.resource].end());
+                }
+                if (lastWriter[access.resource]) {
+                    passDependencies.push_back(*lastWriter[access.resource]);
+                }
+            }
+            for (const Access &access : passes[pass].accesses) {
+                if (access.type != AccessType::READ) {
+                    lastWriter[access.resource] = pass;
+                    accessors[access.resource].clear();
+                } else {
+                    accessors[access.resource].push_back(pass);
+                }
+            }
+            std::sort(passDependencies.begin(), passDependencies.end());
+            passDependencies.erase(std::unique(passDependencies.begin(), passDependencies.end()), passDependencies.end());
+            passDependencies.erase(std::remove(passDependencies.begin(), passDependencies.end(), pass), passDependencies.end());
+        }
+        sortPasses(dependencies);
+
+        VkResult ret = allocateTransients();
+        if (ret != VK_SUCCESS) {
+            release();
+            return ret;
+        }
+
+        for (uint32_t position = 0; position < order.size(); position++) {
+            Pass &pass = passes[order[position]];
+            bool raster = std::any_of(pass.accesses.begin(), pass.accesses.end(), [](const Access &access) { return access.type == AccessType::ATTACHMENT; });
+            if (raster && (pass.renderPass = createRenderPass(pass, position)) == VK_NULL_HANDLE) {
+                release();
+                return VK_ERROR_INITIALIZATION_FAILED;
+            }
+        }
+
+        compiled = true;
+        return VK_SUCCESS;
+    }
+
+    void RenderGraph::recordPass(VkCommandBuffer commandBuffer, const Pass &pass, uint32_t position) {
+
+        // Transient images start over from UNDEFINED at their first use, after whatever last used their memory
+        for (const Access &access : pass.accesses) {
+            const Resource &resource = resources[access.resource];
+            if (resource.desc && resource.firstUse == position) {
+                resource.transient->discardContent(slots[resource.slot].stages, slots[resource.slot].writeAccess);
+            }
+        }
+
+        BarrierBatch barriers;
+        for (const Access &access : pass.accesses) {
+            if (resources[access.resource].buffer) {
+                barriers.transition(*resources[access.resource].buffer, access.access);
+            } else {
+                barriers.transition(getImage(access.resource), access.access);
+            }
+        }
+        barriers.record(commandBuffer);
+
+        if (pass.renderPass == VK_NULL_HANDLE) {
+            pass.execute(commandBuffer);
+            return;
+        }
+
+        std::vector<VkImageView> views;
+        std::vector<VkClearValue> clearValues;
+        VkExtent2D extent = {};
+        for (const Access &access : pass.accesses) {
+            if (access.type == AccessType::ATTACHMENT) {
+                const Image &image = getImage(access.resource);
+                extent = image.getExtent();
+                views.push_back(image.getView());
+                clearValues.push_back(access.clear ? *access.clear : VkClearValue{});
+            }
+        }
+
+        VkFramebuffer framebuffer = device.getFramebufferCache().getFramebuffer(pass.renderPass, views, extent);
+        ASSERT_MSG(framebuffer != VK_NULL_HANDLE, "framebuffer creation failed");
+
+        VkRenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = pass.renderPass;
+        renderPassInfo.framebuffer = framebuffer;
+        renderPassInfo.renderArea.extent = extent;
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues = clearValues.data();
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        pass.execute(commandBuffer);
+        vkCmdEndRenderPass(commandBuffer);
+    }
+
+    void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+        ASSERT_MSG(compiled, "render graph executed before being compiled");
+        for (uint32_t position = 0; position < order.size(); position++) {
+            recordPass(commandBuffer, passes[order[position]], position);
+        }
+    }
+
+    Image &RenderGraph::getImage(ResourceId resource) const {
+        const Resource &entry = resources.at(resource);
+        ASSERT_MSG(entry.image != nullptr || entry.transient != nullptr, "not an image, or a transient image not used by any pass");
+        return entry.image != nullptr ? *entry.image : *entry.transient;
+    }
+
+    Buffer &RenderGraph::getBuffer(ResourceId resource) const {
+        const Resource &entry = resources.at(resource);
+        ASSERT_MSG(entry.buffer != nullptr, "not a buffer");
+        return *entry.buffer;
+    }
+
+    const std::vector<RenderGraph::PassId> &RenderGraph::getExecutionOrder() const { return order; }
+    bool RenderGraph::isCulled(PassId pass) const { return passes.at(pass).culled; }
+    const std::string &RenderGraph::getPassName(PassId pass) const { return passes.at(pass).name; }
+    VkRenderPass RenderGraph::getRenderPass(PassId pass) const { return passes.at(pass).renderPass; }
+
+    VkDeviceSize RenderGraph::getTransientMemorySize() const {
+        VkDeviceSize size = 0;
+        for (const MemorySlot &slot : slots) {
+            size += slot.requirements.size;
+        }
+        return size;
+    }
+
+    VkDeviceSize RenderGraph::getTransientRequestedSize() const { return requestedSize; }
+
+    void RenderGraph::nextFrame() {
+        frame++;
+        while (!retired.empty() && retired.front().frame + framesInFlight <= frame) {
+            destroy(retired.front());
+            retired.pop_front();
+        }
+    }
+
+    void RenderGraph::release() {
+        Retired objects;
+        objects.frame = frame;
+        for (Pass &pass : passes) {
+            if (pass.renderPass != VK_NULL_HANDLE) {
+                objects.renderPasses.push_back(pass.renderPass);
+                pass.renderPass = VK_NULL_HANDLE;
+            }
+        }
+        for (Resource &resource : resources) {
+            if (resource.transient) {
+                objects.images.push_back(std::move(resource.transient));
+            }
+        }
+        for (MemorySlot &slot : slots) {
+            objects.allocations.push_back(slot.allocation);
+        }
+        if (!objects.renderPasses.empty() || !objects.images.empty() || !objects.allocations.empty()) {
+            retired.push_back(std::move(objects));
+        }
+
+        slots.clear();
+        order.clear();
+        requestedSize = 0;
+        compiled = false;
+    }
+
+    void RenderGraph::destroy(Retired &objects) {
+        for (VkRenderPass renderPass : objects.renderPasses) {
+            renderPassFactory.destroyRenderPass(renderPass);
+        }
+
+        // Images before the memory they are bound to
+        objects.images.clear();
+        for (MemoryAllocation &allocation : objects.allocations) {
+            device.getAllocator().free(allocation);
+        }
+    }
+
+    RenderGraph::~RenderGraph() {
+        release();
+        for (Retired &objects : retired) {
+            destroy(objects);
+        }
+    }
+
+} // namespace HLVulkan
@@ -4,15 +4,66 @@ namespace HLVulkan {
 
     RenderPassFactory::RenderPassFactory(HLVulkan::Device &device) : device(device) {}
 
-    void RenderPassFactory::addRenderPassToSet(VkRenderPass &renderPass) { createdRenderPasses.insert(renderPass); }
+    StateKey RenderPassFactory::getCompatibilityKey(const std::vector<VkAttachmentDescription> &attachments,
+                                                    const std::vector<VkSubpassDescription> &subpasses,
+                                                    const std::vector<VkSubpassDependency> &dependencies) {
+        StateKey key;
+        auto addReferences = [&](uint32_t count, const VkAttachmentReference *references) {
+            key.add(references ? count : 0);
+            for (uint32_t i = 0; references && i < count; i++) {
+                const uint32_t attachment = references[i].attachment;
+                if (attachment == VK_ATTACHMENT_UNUSED || attachment >= attachments.size()) {
+                    key.add(VK_ATTACHMENT_UNUSED);
+                } else {
+                    key.add(attachments[attachment].flags).add(attachments[attachment].format).add(attachments[attachment].samples);
+                }
+            }
+        };
+
+        key.add(static_cast<uint32_t>(subpasses.size()));
+        for (const VkSubpassDescription &subpass : subpasses) {
+            key.add(subpass.flags).add(subpass.pipelineBindPoint);
+            addReferences(subpass.inputAttachmentCount, subpass.pInputAttachments);
+            addReferences(subpass.colorAttachmentCount, subpass.pColorAttachments);
+            addReferences(subpass.colorAttachmentCount, subpass.pResolveAttachments);
+            addReferences(1, subpass.pDepthStencilAttachment);
+            key.add(subpass.pPreserveAttachments ? subpass.preserveAttachmentCount : 0);
+            for (uint32_t i = 0; subpass.pPreserveAttachments && i < subpass.preserveAttachmentCount; i++) {
+                key.add(subpass.pPreserveAttachments[i]);
+            }
+        }
+
+        // Dependencies are only ignored for render passes of a single subpass
+        if (subpasses.size() > 1) {
+            key.add(dependencies);
+        }
+        return key;
+    }
+
+    void RenderPassFactory::addRenderPass(VkRenderPass renderPass, const StateKey &key, const StateKey &compatibilityKey) {
+        renderPasses.emplace(renderPass, RenderPassRecord{1, key});
+        renderPassesByKey.emplace(key, renderPass);
+        device.getRenderPassRegistry().add(renderPass, compatibilityKey);
+    }
 
     void RenderPassFactory::destroyRenderPass(VkRenderPass renderPass) {
-        ASSERT_MSG(createdRenderPasses.erase(renderPass) == 1, "attempting to delete non-existent render pass");
+        auto it = renderPasses.find(renderPass);
+        ASSERT_MSG(it != renderPasses.end(), "attempting to delete non-existent render pass");
+
+        if (it != renderPasses.end() && --it->second.refCount == 0) {
+            renderPassesByKey.erase(it->second.key);
+            renderPasses.erase(it);
+            device.getRenderPassRegistry().remove(renderPass);
+            device.getFramebufferCache().evictRenderPass(renderPass);
+            vkDestroyRenderPass(device.logical, renderPass, nullptr);
+        }
     }
 
     RenderPassFactory::~RenderPassFactory() {
-        for (const auto &renderPass : createdRenderPasses) {
-            vkDestroyRenderPass(device.logical, renderPass, nullptr);
+        for (const auto &renderPass : renderPasses) {
+            device.getRenderPassRegistry().remove(renderPass.first);
+            device.getFramebufferCache().evictRenderPass(renderPass.first);
+            vkDestroyRenderPass(device.logical, renderPass.first, nullptr);
         }
     }
 
@@ -0,0 +1,24 @@
+#include "render_pass_registry.hpp"
+
+namespace HLVulkan {
+
+    void RenderPassRegistry::add(VkRenderPass renderPass, const StateKey &compatibilityKey) {
+        std::lock_guard<std::mutex> lock(mutex);
+        keys[renderPass] = compatibilityKey;
+    }
+
+    void RenderPassRegistry::remove(VkRenderPass renderPass) {
+        std::lock_guard<std::mutex> lock(mutex);
+        keys.erase(renderPass);
+    }
+
+    std::optional<StateKey> RenderPassRegistry::getCompatibilityKey(VkRenderPass renderPass) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = keys.find(renderPass);
+        if (it == keys.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+} // namespace HLVulkan
@@ -1,11 +1,49 @@
 #include "render_pass_spec.hpp"
 
+#include "image.hpp"
+
 namespace HLVulkan {
 
     std::vector<VkAttachmentDescription> RenderPassSpec::getAttachments() const { return createAttachments(); }
     std::vector<VkSubpassDescription> RenderPassSpec::getSubpasses() const { return createSubpasses(); }
     std::vector<VkSubpassDependency> RenderPassSpec::getDependencies() const { return createDependencies(); }
 
+    VkAttachmentDescription RenderPassSpec::createTransientAttachment(VkFormat format, VkImageLayout layout, bool clear, VkSampleCountFlagBits samples) {
+        VkAttachmentLoadOp loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+
+        VkAttachmentDescription attachment = {};
+        attachment.format = format;
+        attachment.samples = samples;
+        attachment.loadOp = loadOp;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp = hasStencilComponent(format) ? loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachment.finalLayout = layout;
+        return attachment;
+    }
+
+    bool RenderPassSpec::isTransient(const VkAttachmentDescription &attachment) {
+        if (attachment.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD || attachment.storeOp == VK_ATTACHMENT_STORE_OP_STORE) {
+            return false;
+        }
+        return !hasStencilComponent(attachment.format) ||
+               (attachment.stencilLoadOp != VK_ATTACHMENT_LOAD_OP_LOAD && attachment.stencilStoreOp != VK_ATTACHMENT_STORE_OP_STORE);
+    }
+
+    bool RenderPassSpec::checkTransientAttachments(const std::vector<const Image *> &images) const {
+        std::vector<VkAttachmentDescription> attachments = getAttachments();
+        ASSERT_MSG(images.size() == attachments.size(), "one image per attachment expected");
+
+        for (size_t i = 0; i < images.size() && i < attachments.size(); i++) {
+            if (images[i] != nullptr && images[i]->isTransient() && !isTransient(attachments[i])) {
+                ASSERT_MSG(false, "transient image backing an attachment that is loaded or stored");
+                return false;
+            }
+        }
+        return true;
+    }
+
     RenderPassSpec::~RenderPassSpec() {}
 
 } // namespace HLVulkan
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "resource_pool.hpp"
+
+namespace HLVulkan {
+
+    ResourcePool::ResourcePool(Device device, uint32_t reuseDelay, uint32_t idleFrames) : device(device), reuseDelay(reuseDelay), idleFrames(idleFrames) {
+        ASSERT_MSG(idleFrames >= reuseDelay, "resources would be trimmed before they can be reused");
+    }
+
+    StateKey ResourcePool::imageKey(VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                                    VkMemoryPropertyFlags properties, uint32_t mipLevels) {
+        StateKey key;
+        key.add(extent.width).add(extent.height).add(format).add(tiling).add(usage).add(aspect).add(properties).add(mipLevels);
+        return key;
+    }
+
+    StateKey ResourcePool::bufferKey(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool persistentMap) {
+        StateKey key;
+        key.add(size).add(usage).add(properties).add(persistentMap);
+        return key;
+    }
+
+    template <class Resource> std::unique_ptr<Resource> ResourcePool::reuse(FreeList<Resource> &freeList, const StateKey &key) {
+        auto it = freeList.find(key);
+        if (it == freeList.end() || it->second.front().releaseFrame + reuseDelay > frame) {
+            stats.misses++;
+            return nullptr;
+        }
+
+        std::unique_ptr<Resource> resource = std::move(it->second.front().resource);
+        it->second.pop_front();
+        if (it->second.empty()) {
+            freeList.erase(it);
+        }
+        stats.hits++;
+        return resource;
+    }
+
+    std::unique_ptr<Image> ResourcePool::acquireImage(VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+                                                      VkImageAspectFlags aspect, VkMemoryPropertyFlags properties, uint32_t mipLevels) {
+        std::unique_ptr<Image> image = reuse(freeImages, imageKey(extent, format, tiling, usage, aspect, properties, mipLevels));
+        if (image) {
+            // The last use is reuseDelay frames old, nothing to wait for
+            image->discardContent(0, 0);
+            return image;
+        }
+        return std::make_unique<Image>(device, extent, format, tiling, usage, aspect, properties, mipLevels);
+    }
+
+    std::unique_ptr<Buffer> ResourcePool::acquireBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                                        bool persistentMap) {
+        std::unique_ptr<Buffer> buffer = reuse(freeBuffers, bufferKey(size, usage, properties, persistentMap));
+        if (buffer) {
+            return buffer;
+        }
+        return std::make_unique<Buffer>(device, size, usage, properties, persistentMap);
+    }
+
+    void ResourcePool::release(std::unique_ptr<Image> image) {
+        ASSERT_MSG(!image->isConcurrent() && image->getAllocation().block != nullptr, "image can't be pooled");
+        StateKey key = imageKey(image->getExtent(), image->getFormat(), image->getTiling(), image->getUsage(), image->getAspect(),
+                                image->getMemoryProperties(), image->getMipLevels());
+        freeImages[key].push_back({std::move(image), frame});
+    }
+
+    void ResourcePool::release(std::unique_ptr<Buffer> buffer) {
+        ASSERT_MSG(!buffer->isConcurrent() && buffer->getAllocation().block != nullptr, "buffer can't be pooled");
+        StateKey key = bufferKey(buffer->getSize(), buffer->getUsageFlags(), buffer->getMemoryProperties(), buffer->isPersistentlyMapped());
+        freeBuffers[key].push_back({std::move(buffer), frame});
+    }
+
+    template <class Resource> void ResourcePool::trimIdle(FreeList<Resource> &freeList) {
+        for (auto it = freeList.begin(); it != freeList.end();) {
+            auto &resources = it->second;
+            while (!resources.empty() && resources.front().releaseFrame + idleFrames <= frame) {
+                resources.pop_front();
+                stats.trimmed++;
+            }
+            it = resources.empty() ? freeList.erase(it) : std::next(it);
+        }
+    }
+
+    void ResourcePool::nextFrame() {
+        frame++;
+        trimIdle(freeImages);
+        trimIdle(freeBuffers);
+    }
+
+    void ResourcePool::trim() {
+        for (const auto &entry : freeImages) {
+            stats.trimmed += entry.second.size();
+        }
+        for (const auto &entry : freeBuffers) {
+            stats.trimmed += entry.second.size();
+        }
+        freeImages.clear();
+        freeBuffers.clear();
+    }
+
+    ResourcePoolStats ResourcePool::getStats() const {
+        ResourcePoolStats current = stats;
+        current.freeImages = 0;
+        current.freeBuffers = 0;
+        current.freeBytes = 0;
+        for (const auto &entry : freeImages) {
+            for (const auto &image : entry.second) {
+                current.freeImages++;
+                current.freeBytes += image.resource->getAllocation().size;
+            }
+        }
+        for (const auto &entry : freeBuffers) {
+            for (const auto &buffer : entry.second) {
+                current.freeBuffers++;
+                current.freeBytes += buffer.resource->getAllocation().size;
+            }
+        }
+        return current;
+    }
+
+} // namespace HLVulkan
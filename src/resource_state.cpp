@@ -0,0 +1,93 @@
+#include "resource_state.hpp"
+
+namespace HLVulkan {
+
+    static const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT |
+                                              VK_ACCESS_MEMORY_WRITE_BIT;
+
+    bool ResourceAccess::isWrite() const { return (access & WRITE_ACCESS) != 0; }
+
+    ResourceAccess ResourceAccess::forLayout(VkImageLayout layout) {
+        switch (layout) {
+        case VK_IMAGE_LAYOUT_UNDEFINED:
+            return {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, layout};
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+            return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, layout};
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+            return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, layout};
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+            return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT, layout};
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+            return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, layout};
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, layout};
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, layout};
+        case VK_IMAGE_LAYOUT_PREINITIALIZED:
+            return {VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_WRITE_BIT, layout};
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+            return {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, layout};
+        default:
+            // GENERAL and anything we don't know better about
+            return {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT, layout};
+        }
+    }
+
+    bool ResourceState::transition(const ResourceAccess &next, bool trackLayout, VkPipelineStageFlags &srcStages, VkAccessFlags &srcAccess) {
+
+        // A layout transition writes the whole subresource, so it orders like a write
+        const bool layoutChange = trackLayout && next.layout != layout;
+        const bool write = next.isWrite() || layoutChange;
+
+        bool barrier;
+        if (write) {
+            // Write after write, write after read, or layout transition
+            barrier = layoutChange || writeStages != 0 || readStages != 0;
+            srcStages = writeStages | readStages;
+            srcAccess = writeAccess;
+        } else {
+            // Read after write, unless the write was already made visible to this access
+            barrier = writeStages != 0 && ((next.stages & ~visibleStages) != 0 || (next.access & ~visibleAccess) != 0);
+            srcStages = writeStages;
+            srcAccess = writeAccess;
+        }
+
+        if (write) {
+            if (trackLayout) {
+                layout = next.layout;
+            }
+            // A read-only access after a layout transition must still be ordered after the barrier that performed it
+            writeStages = next.stages;
+            writeAccess = next.access & WRITE_ACCESS;
+            visibleStages = next.isWrite() ? 0 : next.stages;
+            visibleAccess = next.isWrite() ? 0 : next.access;
+            readStages = next.isWrite() ? 0 : next.stages;
+        } else {
+            if (barrier) {
+                visibleStages |= next.stages;
+                visibleAccess |= next.access;
+            }
+            readStages |= next.stages;
+        }
+        return barrier;
+    }
+
+    void ResourceState::record(const ResourceAccess &access, bool trackLayout) {
+        if (trackLayout) {
+            layout = access.layout;
+        }
+        if (access.isWrite()) {
+            writeStages = access.stages;
+            writeAccess = access.access & WRITE_ACCESS;
+            visibleStages = 0;
+            visibleAccess = 0;
+            readStages = 0;
+        } else {
+            readStages |= access.stages;
+        }
+    }
+
+} // namespace HLVulkan
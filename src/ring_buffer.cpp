@@ -0,0 +1,65 @@
+#include "ring_buffer.hpp"
+
+namespace HLVulkan {
+
+    RingBuffer::RingBuffer(Device device, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t framesInFlight, VkMemoryPropertyFlags properties)
+        : buffer(device, size, usage, properties | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, true), capacity(size), framesInFlight(framesInFlight),
+          coherent(buffer.isCoherent()) {
+        ASSERT_MSG(framesInFlight != 0, "framesInFlight must be strictly positive");
+    }
+
+    void RingBuffer::beginFrame() {
+        if (frameEnds.size() == framesInFlight) {
+            tail = frameEnds.front();
+            frameEnds.pop_front();
+        }
+        frameStart = head;
+    }
+
+    std::optional<RingAllocation> RingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+
+        ASSERT_MSG(alignment != 0, "alignment must be strictly positive");
+
+        VkDeviceSize position = head % capacity;
+        VkDeviceSize offset = (position + alignment - 1) / alignment * alignment;
+
+        // Skip the end of the buffer if the slice doesn't fit before it
+        if (offset + size > capacity) {
+            offset = 0;
+        }
+
+        VkDeviceSize newHead = head + (offset >= position ? offset - position : capacity - position) + size;
+        if (newHead - tail > capacity) {
+            return {};
+        }
+
+        head = newHead;
+        return RingAllocation{static_cast<char *>(buffer.getMappedData()) + offset, offset, buffer.getBuffer()};
+    }
+
+    VkResult RingBuffer::endFrame() {
+
+        frameEnds.push_back(head);
+        if (coherent || head == frameStart) {
+            return VK_SUCCESS;
+        }
+
+        // The frame's slices may wrap around the end of the buffer
+        VkDeviceSize start = frameStart % capacity;
+        VkDeviceSize end = head % capacity;
+        if (head - frameStart >= capacity) {
+            return buffer.flush();
+        } else if (start < end) {
+            return buffer.flush(start, end - start);
+        }
+        VK_CHECK_RET(buffer.flush(start, capacity - start));
+        return end == 0 ? VK_SUCCESS : buffer.flush(0, end);
+    }
+
+    VkBuffer RingBuffer::getBuffer() { return buffer.getBuffer(); }
+
+    VkDeviceSize RingBuffer::getCapacity() const { return capacity; }
+
+    VkDeviceSize RingBuffer::getUsedBytes() const { return head - tail; }
+
+} // namespace HLVulkan
@@ -4,12 +4,12 @@
 
 namespace HLVulkan {
 
-    static VkResult createShaderModule(VkDevice logical, const std::vector<char> &code, VkShaderModule &shaderModule) {
+    static VkResult createShaderModule(VkDevice logical, const uint32_t *code, size_t size, VkShaderModule &shaderModule) {
 
         VkShaderModuleCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+        createInfo.codeSize = size;
+        createInfo.pCode = code;
 
         return vkCreateShaderModule(logical, &createInfo, nullptr, &shaderModule);
     }
@@ -40,9 +40,25 @@ namespace HLVulkan {
     Shader::Shader(Device device, const std::string &filename, VkShaderStageFlagBits stage, const std::string &pName)
         : device(device), filename(filename), stage(stage), pName(pName) {}
 
+    Shader::Shader(Device device, std::shared_ptr<const ShaderArchive> archive, const std::string &name, VkShaderStageFlagBits stage,
+                   const std::string &pName)
+        : device(device), filename(name), archive(std::move(archive)), stage(stage), pName(pName) {}
+
     std::optional<VkPipelineShaderStageCreateInfo> Shader::getShaderStageInfo() {
 
-        if (shaderModule == VK_NULL_HANDLE) {
+        if (shaderModule == VK_NULL_HANDLE && archive) {
+            std::optional<ShaderArchiveEntry> entry = archive->find(filename);
+            if (!entry) {
+                std::cout << "failed to read shader " << filename << ": not found in archive " << archive->getFilename() << std::endl;
+                return {};
+            }
+
+            VkResult vkRet;
+            if ((vkRet = createShaderModule(device.logical, entry->code, entry->size, shaderModule)) != VK_SUCCESS) {
+                std::cout << "failed to create shader module: vkCreateShaderModule() failed with error code " << vkRet << std::endl;
+                return {};
+            }
+        } else if (shaderModule == VK_NULL_HANDLE) {
             std::vector<char> data;
             int ret;
             if ((ret = readFile(filename, data))) {
@@ -51,7 +67,7 @@ namespace HLVulkan {
             }
 
             VkResult vkRet;
-            if ((vkRet = createShaderModule(device.logical, data, shaderModule)) != VK_SUCCESS) {
+            if ((vkRet = createShaderModule(device.logical, reinterpret_cast<const uint32_t *>(data.data()), data.size(), shaderModule)) != VK_SUCCESS) {
                 std::cout << "failed to create shader module: vkCreateShaderModule() failed with error code " << vkRet << std::endl;
                 return {};
             }
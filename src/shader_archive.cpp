@@ -0,0 +1,229 @@
+#include "shader_archive.hpp"
+
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HL_VULKAN_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "shader.hpp"
+#include "shader_library.hpp"
+
+namespace HLVulkan {
+
+    template <class T> static T readLittleEndian(const char *data) {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+        T value = 0;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            value |= static_cast<T>(bytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    template <class T> static void writeLittleEndian(std::vector<char> &data, T value) {
+        for (size_t i = 0; i < sizeof(T); i++) {
+            data.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    static size_t alignUp(size_t value) { return (value + 3) & ~static_cast<size_t>(3); }
+
+    ShaderArchive::ShaderArchive(const std::string &filename) : filename(filename) {}
+
+    std::shared_ptr<const ShaderArchive> ShaderArchive::open(const std::string &filename) {
+        std::shared_ptr<ShaderArchive> archive(new ShaderArchive(filename));
+        if (!archive->load()) {
+            std::cout << "failed to open shader archive " << filename << ": file can't be read" << std::endl;
+            return nullptr;
+        }
+        if (!archive->parse()) {
+            std::cout << "failed to open shader archive " << filename << ": invalid or corrupted archive" << std::endl;
+            return nullptr;
+        }
+        return archive;
+    }
+
+    bool ShaderArchive::load() {
+
+#ifdef HL_VULKAN_HAS_MMAP
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *address = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (address != MAP_FAILED) {
+                    data = static_cast<const char *>(address);
+                    size = static_cast<size_t>(st.st_size);
+                    mapped = true;
+                }
+            }
+            // The mapping stays valid once the descriptor is closed
+            close(fd);
+            if (mapped) {
+                return true;
+            }
+        }
+#endif
+
+        // Read in one go into word-aligned storage
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        size = static_cast<size_t>(file.tellg());
+        fallback.resize((size + 3) / 4);
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(fallback.data()), size);
+        data = reinterpret_cast<const char *>(fallback.data());
+        return static_cast<bool>(file);
+    }
+
+    bool ShaderArchive::parse() {
+
+        if (size < HEADER_SIZE || readLittleEndian<uint32_t>(data) != MAGIC || readLittleEndian<uint32_t>(data + 4) != VERSION) {
+            return false;
+        }
+        uint64_t entryCount = readLittleEndian<uint32_t>(data + 8);
+        uint64_t stringTableSize = readLittleEndian<uint32_t>(data + 12);
+
+        const uint64_t stringTableOffset = HEADER_SIZE + entryCount * INDEX_ENTRY_SIZE;
+        if (stringTableOffset + stringTableSize > size) {
+            return false;
+        }
+
+        for (uint64_t i = 0; i < entryCount; i++) {
+            const char *entry = data + HEADER_SIZE + i * INDEX_ENTRY_SIZE;
+            uint64_t codeOffset = readLittleEndian<uint64_t>(entry);
+            uint64_t codeSize = readLittleEndian<uint64_t>(entry + 8);
+            uint64_t codeHash = readLittleEndian<uint64_t>(entry + 16);
+            uint64_t nameOffset = readLittleEndian<uint32_t>(entry + 24);
+            uint64_t nameSize = readLittleEndian<uint32_t>(entry + 28);
+
+            // Bounds are checked against the remaining size so that corrupted offsets can't overflow
+            if (codeOffset % 4 != 0 || codeSize == 0 || codeSize % 4 != 0 || codeOffset > size || codeSize > size - codeOffset ||
+                nameOffset > stringTableSize || nameSize > stringTableSize - nameOffset) {
+                return false;
+            }
+
+            std::string name(data + stringTableOffset + nameOffset, nameSize);
+            ShaderArchiveEntry shader = {reinterpret_cast<const uint32_t *>(data + codeOffset), static_cast<size_t>(codeSize), codeHash};
+            if (!entries.emplace(name, shader).second) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::optional<ShaderArchiveEntry> ShaderArchive::find(const std::string &name) const {
+        auto it = entries.find(name);
+        if (it == entries.end()) {
+            return {};
+        }
+
+        // The library trusts the stored hash, so a corrupted blob must not get through with its original hash. Concurrent first lookups may
+        // both hash the blob, they reach the same verdict.
+        const Blob &blob = it->second;
+        Verification verification = blob.verification.load();
+        if (verification == Verification::PENDING) {
+            const char *code = reinterpret_cast<const char *>(blob.shader.code);
+            verification = hashShaderCode(code, blob.shader.size) == blob.shader.hash ? Verification::VALID : Verification::CORRUPTED;
+            blob.verification.store(verification);
+            if (verification == Verification::CORRUPTED) {
+                std::cout << "shader " << name << " in archive " << filename << " is corrupted: hash mismatch" << std::endl;
+            }
+        }
+        if (verification != Verification::VALID) {
+            return {};
+        }
+        return blob.shader;
+    }
+
+    std::vector<std::string> ShaderArchive::getNames() const {
+        std::vector<std::string> names;
+        names.reserve(entries.size());
+        for (const auto &entry : entries) {
+            names.push_back(entry.first);
+        }
+        return names;
+    }
+
+    const std::string &ShaderArchive::getFilename() const { return filename; }
+
+    ShaderArchive::~ShaderArchive() {
+#ifdef HL_VULKAN_HAS_MMAP
+        if (mapped) {
+            munmap(const_cast<char *>(data), size);
+        }
+#endif
+    }
+
+    bool ShaderArchiveBuilder::add(const std::string &name, const std::vector<char> &code) {
+        if (code.empty() || code.size() % 4 != 0) {
+            std::cout << "can't add shader " << name << " to archive: code size is not a non-zero multiple of 4" << std::endl;
+            return false;
+        }
+        for (const auto &shader : shaders) {
+            if (shader.first == name) {
+                std::cout << "can't add shader " << name << " to archive: name already used" << std::endl;
+                return false;
+            }
+        }
+        shaders.emplace_back(name, code);
+        return true;
+    }
+
+    bool ShaderArchiveBuilder::addFile(const std::string &name, const std::string &filename) {
+        std::vector<char> code;
+        int ret;
+        if ((ret = Shader::readFile(filename, code))) {
+            std::cout << "failed to read shader " << filename << ": readfile() failed with error code " << ret << std::endl;
+            return false;
+        }
+        return add(name, code);
+    }
+
+    bool ShaderArchiveBuilder::write(const std::string &filename) const {
+
+        uint32_t stringTableSize = 0;
+        for (const auto &shader : shaders) {
+            stringTableSize += static_cast<uint32_t>(shader.first.size());
+        }
+
+        std::vector<char> data;
+        writeLittleEndian<uint32_t>(data, ShaderArchive::MAGIC);
+        writeLittleEndian<uint32_t>(data, ShaderArchive::VERSION);
+        writeLittleEndian<uint32_t>(data, static_cast<uint32_t>(shaders.size()));
+        writeLittleEndian<uint32_t>(data, stringTableSize);
+
+        // Index
+        uint64_t codeOffset = alignUp(ShaderArchive::HEADER_SIZE + shaders.size() * ShaderArchive::INDEX_ENTRY_SIZE + stringTableSize);
+        uint32_t nameOffset = 0;
+        for (const auto &shader : shaders) {
+            writeLittleEndian<uint64_t>(data, codeOffset);
+            writeLittleEndian<uint64_t>(data, shader.second.size());
+            writeLittleEndian<uint64_t>(data, hashShaderCode(shader.second.data(), shader.second.size()));
+            writeLittleEndian<uint32_t>(data, nameOffset);
+            writeLittleEndian<uint32_t>(data, static_cast<uint32_t>(shader.first.size()));
+            codeOffset += shader.second.size();
+            nameOffset += static_cast<uint32_t>(shader.first.size());
+        }
+
+        // String table
+        for (const auto &shader : shaders) {
+            data.insert(data.end(), shader.first.begin(), shader.first.end());
+        }
+
+        // Blobs, their sizes are multiples of 4 so only the first one needs padding
+        data.resize(alignUp(data.size()), 0);
+        for (const auto &shader : shaders) {
+            data.insert(data.end(), shader.second.begin(), shader.second.end());
+        }
+
+        return writeFileAtomically(filename, data.data(), data.size());
+    }
+
+} // namespace HLVulkan
@@ -0,0 +1,159 @@
+#include "shader_library.hpp"
+
+#include <string.h>
+
+#include "shader.hpp"
+
+namespace HLVulkan {
+
+    // 64-bit FNV-1a, collisions are negligible for the number of shaders an application ships
+    uint64_t hashShaderCode(const char *code, size_t size) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= static_cast<unsigned char>(code[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash ^ size;
+    }
+
+    ShaderModule::ShaderModule(VkDevice device, VkShaderModule module, uint64_t id, uint64_t hash, std::shared_ptr<const void> source,
+                               const uint32_t *code, size_t size)
+        : device(device), module(module), id(id), hash(hash), source(std::move(source)), code(code), size(size) {}
+
+    VkShaderModule ShaderModule::getModule() const { return module; }
+
+    uint64_t ShaderModule::getId() const { return id; }
+
+    uint64_t ShaderModule::getHash() const { return hash; }
+
+    size_t ShaderModule::getCodeSize() const { return size; }
+
+    bool ShaderModule::hasCode(const uint32_t *other, size_t otherSize) const { return otherSize == size && memcmp(code, other, size) == 0; }
+
+    ShaderModule::~ShaderModule() { vkDestroyShaderModule(device, module, nullptr); }
+
+    ShaderLibrary::ShaderLibrary(VkDevice device) : device(device) {}
+
+    void ShaderLibrary::mountArchive(std::shared_ptr<const ShaderArchive> archive) {
+        std::lock_guard<std::mutex> lock(mutex);
+        archives.push_back(std::move(archive));
+    }
+
+    std::shared_ptr<const ShaderModule> ShaderLibrary::load(const std::string &filename) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::shared_ptr<const ShaderModule> module;
+        auto it = modulesByPath.find(filename);
+        if (it != modulesByPath.end()) {
+            if ((module = it->second.lock())) {
+                return module;
+            }
+            modulesByPath.erase(it);
+        }
+
+        // Archives already carry the hash and the code is used in place, the module keeps the archive mapped
+        for (const auto &archive : archives) {
+            std::optional<ShaderArchiveEntry> entry = archive->find(filename);
+            if (entry) {
+                module = findOrCreate(entry->code, entry->size, entry->hash, archive);
+                if (module) {
+                    modulesByPath.emplace(filename, module);
+                }
+                return module;
+            }
+        }
+
+        auto data = std::make_shared<std::vector<char>>();
+        int ret;
+        stats.fileReads++;
+        if ((ret = Shader::readFile(filename, *data))) {
+            std::cout << "failed to read shader " << filename << ": readfile() failed with error code " << ret << std::endl;
+            return nullptr;
+        }
+
+        uint64_t hash = hashShaderCode(data->data(), data->size());
+        module = findOrCreate(reinterpret_cast<const uint32_t *>(data->data()), data->size(), hash, data);
+        if (module) {
+            modulesByPath.emplace(filename, module);
+        }
+        return module;
+    }
+
+    std::shared_ptr<const ShaderModule> ShaderLibrary::loadCode(const char *code, size_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return findOrCreate(reinterpret_cast<const uint32_t *>(code), size, hashShaderCode(code, size), nullptr);
+    }
+
+    std::shared_ptr<const ShaderModule> ShaderLibrary::findOrCreate(const uint32_t *code, size_t size, uint64_t hash,
+                                                                    std::shared_ptr<const void> source) {
+
+        // The hash only narrows the search, different SPIR-V with the same hash gets its own module
+        auto range = modulesByHash.equal_range(hash);
+        for (auto it = range.first; it != range.second; it++) {
+            if (it->second->hasCode(code, size)) {
+                return it->second;
+            }
+        }
+
+        VkShaderModuleCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = size;
+        createInfo.pCode = code;
+
+        VkResult ret;
+        VkShaderModule module;
+        if ((ret = vkCreateShaderModule(device, &createInfo, nullptr, &module)) != VK_SUCCESS) {
+            std::cout << "failed to create shader module: vkCreateShaderModule() failed with error code " << ret << std::endl;
+            return nullptr;
+        }
+        stats.modulesCreated++;
+
+        // The caller's buffer of loadCode() isn't ours to keep
+        if (!source) {
+            auto copy = std::make_shared<std::vector<uint32_t>>(code, code + size / sizeof(uint32_t));
+            code = copy->data();
+            source = std::move(copy);
+        }
+
+        auto shaderModule = std::make_shared<const ShaderModule>(device, module, nextModuleId++, hash, std::move(source), code, size);
+        modulesByHash.emplace(hash, shaderModule);
+        return shaderModule;
+    }
+
+    size_t ShaderLibrary::releaseUnused() {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        size_t released = 0;
+        for (auto it = modulesByHash.begin(); it != modulesByHash.end();) {
+            if (it->second.use_count() == 1) {
+                it = modulesByHash.erase(it);
+                released++;
+            } else {
+                it++;
+            }
+        }
+
+        // Forget the paths of the destroyed modules, they'll be read again if needed
+        for (auto it = modulesByPath.begin(); it != modulesByPath.end();) {
+            it = it->second.expired() ? modulesByPath.erase(it) : std::next(it);
+        }
+        return released;
+    }
+
+    void ShaderLibrary::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &module : modulesByHash) {
+            ASSERT_MSG(module.second.use_count() == 1, "shader module still referenced");
+        }
+        modulesByHash.clear();
+        modulesByPath.clear();
+    }
+
+    ShaderLibraryStats ShaderLibrary::getStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        ShaderLibraryStats current = stats;
+        current.moduleCount = static_cast<uint32_t>(modulesByHash.size());
+        return current;
+    }
+
+} // namespace HLVulkan
@@ -0,0 +1,175 @@
+#include "state_key.hpp"
+
+namespace HLVulkan {
+
+    void StateKey::addNext(const void *pNext) {
+        if (pNext != nullptr) {
+            valid = false;
+        }
+    }
+
+    StateKey &StateKey::add(const std::string &value) {
+        add(static_cast<uint32_t>(value.size()));
+        bytes.append(value);
+        return *this;
+    }
+
+    StateKey &StateKey::add(const VkVertexInputBindingDescription &binding) { return add(binding.binding).add(binding.stride).add(binding.inputRate); }
+
+    StateKey &StateKey::add(const VkVertexInputAttributeDescription &attribute) {
+        return add(attribute.location).add(attribute.binding).add(attribute.format).add(attribute.offset);
+    }
+
+    StateKey &StateKey::add(const VkPipelineInputAssemblyStateCreateInfo &inputAssembly) {
+        addNext(inputAssembly.pNext);
+        return add(inputAssembly.flags).add(inputAssembly.topology).add(inputAssembly.primitiveRestartEnable);
+    }
+
+    StateKey &StateKey::add(const VkViewport &viewport) {
+        return add(viewport.x).add(viewport.y).add(viewport.width).add(viewport.height).add(viewport.minDepth).add(viewport.maxDepth);
+    }
+
+    StateKey &StateKey::add(const VkRect2D &scissor) {
+        return add(scissor.offset.x).add(scissor.offset.y).add(scissor.extent.width).add(scissor.extent.height);
+    }
+
+    StateKey &StateKey::add(const VkPipelineRasterizationStateCreateInfo &rasterizer) {
+        addNext(rasterizer.pNext);
+        return add(rasterizer.flags)
+            .add(rasterizer.depthClampEnable)
+            .add(rasterizer.rasterizerDiscardEnable)
+            .add(rasterizer.polygonMode)
+            .add(rasterizer.cullMode)
+            .add(rasterizer.frontFace)
+            .add(rasterizer.depthBiasEnable)
+            .add(rasterizer.depthBiasConstantFactor)
+            .add(rasterizer.depthBiasClamp)
+            .add(rasterizer.depthBiasSlopeFactor)
+            .add(rasterizer.lineWidth);
+    }
+
+    StateKey &StateKey::add(const VkPipelineMultisampleStateCreateInfo &multisampling) {
+        addNext(multisampling.pNext);
+        add(multisampling.flags)
+            .add(multisampling.rasterizationSamples)
+            .add(multisampling.sampleShadingEnable)
+            .add(multisampling.minSampleShading)
+            .add(multisampling.alphaToCoverageEnable)
+            .add(multisampling.alphaToOneEnable);
+
+        // The sample mask holds one bit per sample
+        add(multisampling.pSampleMask != nullptr);
+        if (multisampling.pSampleMask) {
+            for (uint32_t i = 0; i < (static_cast<uint32_t>(multisampling.rasterizationSamples) + 31) / 32; i++) {
+                add(multisampling.pSampleMask[i]);
+            }
+        }
+        return *this;
+    }
+
+    StateKey &StateKey::add(const VkPipelineColorBlendAttachmentState &colorBlendAttachment) {
+        return add(colorBlendAttachment.blendEnable)
+            .add(colorBlendAttachment.srcColorBlendFactor)
+            .add(colorBlendAttachment.dstColorBlendFactor)
+            .add(colorBlendAttachment.colorBlendOp)
+            .add(colorBlendAttachment.srcAlphaBlendFactor)
+            .add(colorBlendAttachment.dstAlphaBlendFactor)
+            .add(colorBlendAttachment.alphaBlendOp)
+            .add(colorBlendAttachment.colorWriteMask);
+    }
+
+    StateKey &StateKey::add(const VkStencilOpState &stencilOp) {
+        return add(stencilOp.failOp)
+            .add(stencilOp.passOp)
+            .add(stencilOp.depthFailOp)
+            .add(stencilOp.compareOp)
+            .add(stencilOp.compareMask)
+            .add(stencilOp.writeMask)
+            .add(stencilOp.reference);
+    }
+
+    StateKey &StateKey::add(const VkPipelineDepthStencilStateCreateInfo &depthStencil) {
+        addNext(depthStencil.pNext);
+        return add(depthStencil.flags)
+            .add(depthStencil.depthTestEnable)
+            .add(depthStencil.depthWriteEnable)
+            .add(depthStencil.depthCompareOp)
+            .add(depthStencil.depthBoundsTestEnable)
+            .add(depthStencil.stencilTestEnable)
+            .add(depthStencil.front)
+            .add(depthStencil.back)
+            .add(depthStencil.minDepthBounds)
+            .add(depthStencil.maxDepthBounds);
+    }
+
+    StateKey &StateKey::add(const VkDescriptorSetLayoutBinding &binding) {
+        add(binding.binding).add(binding.descriptorType).add(binding.descriptorCount).add(binding.stageFlags);
+
+        // Immutable samplers are part of the layout, identified by handle
+        add(binding.pImmutableSamplers != nullptr);
+        if (binding.pImmutableSamplers) {
+            for (uint32_t i = 0; i < binding.descriptorCount; i++) {
+                add(binding.pImmutableSamplers[i]);
+            }
+        }
+        return *this;
+    }
+
+    StateKey &StateKey::add(const VkAttachmentDescription &attachment) {
+        return add(attachment.flags)
+            .add(attachment.format)
+            .add(attachment.samples)
+            .add(attachment.loadOp)
+            .add(attachment.storeOp)
+            .add(attachment.stencilLoadOp)
+            .add(attachment.stencilStoreOp)
+            .add(attachment.initialLayout)
+            .add(attachment.finalLayout);
+    }
+
+    StateKey &StateKey::add(const VkAttachmentReference &reference) { return add(reference.attachment).add(reference.layout); }
+
+    StateKey &StateKey::add(const VkSubpassDescription &subpass) {
+        add(subpass.flags).add(subpass.pipelineBindPoint);
+        addArray(subpass.inputAttachmentCount, subpass.pInputAttachments);
+        addArray(subpass.colorAttachmentCount, subpass.pColorAttachments);
+
+        // Resolve attachments, if any, match the color attachments one to one
+        add(subpass.pResolveAttachments != nullptr);
+        if (subpass.pResolveAttachments) {
+            addArray(subpass.colorAttachmentCount, subpass.pResolveAttachments);
+        }
+
+        add(subpass.pDepthStencilAttachment != nullptr);
+        if (subpass.pDepthStencilAttachment) {
+            add(*subpass.pDepthStencilAttachment);
+        }
+
+        addArray(subpass.preserveAttachmentCount, subpass.pPreserveAttachments);
+        return *this;
+    }
+
+    StateKey &StateKey::add(const VkSubpassDependency &dependency) {
+        return add(dependency.srcSubpass)
+            .add(dependency.dstSubpass)
+            .add(dependency.srcStageMask)
+            .add(dependency.dstStageMask)
+            .add(dependency.srcAccessMask)
+            .add(dependency.dstAccessMask)
+            .add(dependency.dependencyFlags);
+    }
+
+    StateKey &StateKey::add(const StateKey &key) {
+        add(static_cast<uint32_t>(key.bytes.size()));
+        bytes.append(key.bytes);
+        valid = valid && key.valid;
+        return *this;
+    }
+
+    bool StateKey::isValid() const { return valid; }
+
+    size_t StateKey::hash() const { return std::hash<std::string>{}(bytes); }
+
+    bool StateKey::operator==(const StateKey &other) const { return valid == other.valid && bytes == other.bytes; }
+
+} // namespace HLVulkan
@@ -0,0 +1,184 @@
+#include "stats.hpp"
+
+#ifdef HL_VULKAN_ENABLE_STATS
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace HLVulkan {
+
+    namespace {
+
+        struct HistogramCounters {
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> totalNs{0};
+            std::atomic<uint64_t> maxNs{0};
+            std::atomic<uint64_t> buckets[Stats::BUCKET_COUNT] = {};
+        };
+
+        // Only written by its thread, aligned so that threads don't share cache lines
+        struct alignas(64) ThreadCounters {
+            std::atomic<uint64_t> counters[Stats::COUNTER_COUNT] = {};
+            HistogramCounters histograms[Stats::HISTOGRAM_COUNT];
+
+            void addTo(Stats::Snapshot &snapshot) const {
+                for (uint32_t i = 0; i < Stats::COUNTER_COUNT; i++) {
+                    snapshot.counters[i] += counters[i].load(std::memory_order_relaxed);
+                }
+                for (uint32_t i = 0; i < Stats::HISTOGRAM_COUNT; i++) {
+                    Stats::HistogramSnapshot &histogram = snapshot.histograms[i];
+                    histogram.count += histograms[i].count.load(std::memory_order_relaxed);
+                    histogram.totalNs += histograms[i].totalNs.load(std::memory_order_relaxed);
+                    histogram.maxNs = std::max(histogram.maxNs, histograms[i].maxNs.load(std::memory_order_relaxed));
+                    for (uint32_t bucket = 0; bucket < Stats::BUCKET_COUNT; bucket++) {
+                        histogram.buckets[bucket] += histograms[i].buckets[bucket].load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            void clear() {
+                for (auto &counter : counters) {
+                    counter.store(0, std::memory_order_relaxed);
+                }
+                for (auto &histogram : histograms) {
+                    histogram.count.store(0, std::memory_order_relaxed);
+                    histogram.totalNs.store(0, std::memory_order_relaxed);
+                    histogram.maxNs.store(0, std::memory_order_relaxed);
+                    for (auto &bucket : histogram.buckets) {
+                        bucket.store(0, std::memory_order_relaxed);
+                    }
+                }
+            }
+        };
+
+        // Never destroyed, threads may exit after static destruction
+        struct Registry {
+            std::mutex mutex;
+            std::vector<ThreadCounters *> threads;
+            Stats::Snapshot exited;
+        };
+
+        Registry &registry() {
+            static Registry *instance = new Registry();
+            return *instance;
+        }
+
+        // Registered on the first record of a thread, folded into the registry when the thread exits
+        struct ThreadSlot {
+            ThreadCounters counters;
+
+            ThreadSlot() {
+                Registry &reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                reg.threads.push_back(&counters);
+            }
+
+            ~ThreadSlot() {
+                Registry &reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                counters.addTo(reg.exited);
+                reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), &counters));
+            }
+        };
+
+        ThreadCounters &threadCounters() {
+            thread_local ThreadSlot slot;
+            return slot.counters;
+        }
+
+        uint32_t getBucket(uint64_t nanoseconds) {
+            uint32_t bucket = 0;
+            while (nanoseconds >>= 1) {
+                bucket++;
+            }
+            return std::min(bucket, Stats::BUCKET_COUNT - 1);
+        }
+
+    } // namespace
+
+    void Stats::add(Counter counter, uint64_t value) { threadCounters().counters[counter].fetch_add(value, std::memory_order_relaxed); }
+
+    void Stats::record(Histogram histogram, uint64_t nanoseconds) {
+        HistogramCounters &counters = threadCounters().histograms[histogram];
+        counters.count.fetch_add(1, std::memory_order_relaxed);
+        counters.totalNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+        counters.buckets[getBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+
+        // Single writer, no need for a compare and swap
+        if (nanoseconds > counters.maxNs.load(std::memory_order_relaxed)) {
+            counters.maxNs.store(nanoseconds, std::memory_order_relaxed);
+        }
+    }
+
+    Stats::Snapshot Stats::snapshot() {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        Snapshot snapshot = reg.exited;
+        for (const ThreadCounters *counters : reg.threads) {
+            counters->addTo(snapshot);
+        }
+        return snapshot;
+    }
+
+    void Stats::reset() {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        reg.exited = Snapshot();
+        for (ThreadCounters *counters : reg.threads) {
+            counters->clear();
+        }
+    }
+
+    uint64_t Stats::HistogramSnapshot::percentile(double fraction) const {
+        if (count == 0) {
+            return 0;
+        }
+
+        uint64_t target = static_cast<uint64_t>(fraction * count);
+        uint64_t seen = 0;
+        for (uint32_t bucket = 0; bucket < BUCKET_COUNT - 1; bucket++) {
+            seen += buckets[bucket];
+            if (seen > target || seen == count) {
+                return std::min(uint64_t(2) << bucket, maxNs);
+            }
+        }
+        return maxNs;
+    }
+
+    const char *Stats::getName(Counter counter) {
+        switch (counter) {
+        case ALLOCATE_MEMORY_CALLS:
+            return "allocate_memory_calls";
+        case QUEUE_SUBMIT_CALLS:
+            return "queue_submit_calls";
+        case QUEUE_WAIT_IDLE_CALLS:
+            return "queue_wait_idle_calls";
+        case MAPPED_BYTES:
+            return "mapped_bytes";
+        case BUFFER_COPY_BYTES:
+            return "buffer_copy_bytes";
+        case IMAGE_UPLOAD_BYTES:
+            return "image_upload_bytes";
+        default:
+            return "unknown";
+        }
+    }
+
+    const char *Stats::getName(Histogram histogram) {
+        switch (histogram) {
+        case SINGLE_TIME_WAIT:
+            return "single_time_wait";
+        case FENCE_WAIT:
+            return "fence_wait";
+        default:
+            return "unknown";
+        }
+    }
+
+} // namespace HLVulkan
+
+#endif // HL_VULKAN_ENABLE_STATS
@@ -0,0 +1,134 @@
+#include "timeline_semaphore.hpp"
+
+#include "stats.hpp"
+
+namespace HLVulkan {
+
+    VkResult queueSubmit(VkQueue queue, const std::vector<VkCommandBuffer> &commandBuffers, const std::vector<TimelineWait> &waits,
+                         const std::vector<TimelinePoint> &signals, VkFence fence) {
+
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<uint64_t> waitValues;
+        std::vector<VkPipelineStageFlags> waitStages;
+        for (const TimelineWait &wait : waits) {
+            waitSemaphores.push_back(wait.semaphore);
+            waitValues.push_back(wait.value);
+            waitStages.push_back(wait.stages);
+        }
+
+        std::vector<VkSemaphore> signalSemaphores;
+        std::vector<uint64_t> signalValues;
+        for (const TimelinePoint &signal : signals) {
+            signalSemaphores.push_back(signal.semaphore);
+            signalValues.push_back(signal.value);
+        }
+
+        // Values of binary semaphores are ignored, but the arrays must match the semaphore counts
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        submitInfo.pCommandBuffers = commandBuffers.data();
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        HL_VULKAN_STATS_ADD(QUEUE_SUBMIT_CALLS, 1);
+        return vkQueueSubmit(queue, 1, &submitInfo, fence);
+    }
+
+    TimelineSemaphore::TimelineSemaphore(Device device, uint64_t initialValue) : device(device) {
+        ASSERT_MSG(device.getCapabilities().supportsTimelineSemaphores(), "timeline semaphores need Vulkan 1.2 and the timelineSemaphore feature");
+
+        VkSemaphoreTypeCreateInfo typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = initialValue;
+
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        VK_CHECK_FAIL(vkCreateSemaphore(device.logical, &semaphoreInfo, nullptr, &semaphore), "failed to create timeline semaphore");
+    }
+
+    VkSemaphore TimelineSemaphore::getSemaphore() const { return semaphore; }
+
+    VkResult TimelineSemaphore::signal(uint64_t value) {
+
+        VkSemaphoreSignalInfo signalInfo = {};
+        signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+        signalInfo.semaphore = semaphore;
+        signalInfo.value = value;
+
+        return vkSignalSemaphore(device.logical, &signalInfo);
+    }
+
+    VkResult TimelineSemaphore::wait(uint64_t value, uint64_t timeout) const { return waitMany(device.logical, {{semaphore, value}}, false, timeout); }
+
+    VkResult TimelineSemaphore::getValue(uint64_t &value) const { return vkGetSemaphoreCounterValue(device.logical, semaphore, &value); }
+
+    bool TimelineSemaphore::isReached(uint64_t value) const {
+        uint64_t current;
+        return getValue(current) == VK_SUCCESS && current >= value;
+    }
+
+    VkResult TimelineSemaphore::waitMany(VkDevice device, const std::vector<TimelinePoint> &points, bool any, uint64_t timeout) {
+
+        std::vector<VkSemaphore> semaphores;
+        std::vector<uint64_t> values;
+        for (const TimelinePoint &point : points) {
+            semaphores.push_back(point.semaphore);
+            values.push_back(point.value);
+        }
+
+        VkSemaphoreWaitInfo waitInfo = {};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.flags = any ? VK_SEMAPHORE_WAIT_ANY_BIT : 0;
+        waitInfo.semaphoreCount = static_cast<uint32_t>(semaphores.size());
+        waitInfo.pSemaphores = semaphores.data();
+        waitInfo.pValues = values.data();
+
+        return vkWaitSemaphores(device, &waitInfo, timeout);
+    }
+
+    TimelineSemaphore::~TimelineSemaphore() { vkDestroySemaphore(device.logical, semaphore, nullptr); }
+
+    QueueTimeline::QueueTimeline(Device device, Queue queue) : queue(queue), semaphore(device) {}
+
+    VkResult QueueTimeline::submit(const std::vector<VkCommandBuffer> &commandBuffers, const std::vector<TimelineWait> &waits, uint64_t &value,
+                                   const std::vector<TimelinePoint> &signals) {
+
+        std::lock_guard<std::mutex> lock(*queue.mutex);
+
+        std::vector<TimelinePoint> allSignals = signals;
+        allSignals.push_back({semaphore.getSemaphore(), lastValue + 1});
+        VK_CHECK_RET(queueSubmit(queue.queue, commandBuffers, waits, allSignals));
+
+        value = ++lastValue;
+        return VK_SUCCESS;
+    }
+
+    TimelinePoint QueueTimeline::getLastSubmitted() const {
+        std::lock_guard<std::mutex> lock(*queue.mutex);
+        return {semaphore.getSemaphore(), lastValue};
+    }
+
+    VkResult QueueTimeline::wait(uint64_t value, uint64_t timeout) const { return semaphore.wait(value, timeout); }
+
+    bool QueueTimeline::isComplete(uint64_t value) const { return semaphore.isReached(value); }
+
+    TimelineSemaphore &QueueTimeline::getSemaphore() { return semaphore; }
+
+    std::mutex &QueueTimeline::getQueueMutex() const { return *queue.mutex; }
+
+} // namespace HLVulkan
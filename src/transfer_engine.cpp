@@ -0,0 +1,263 @@
+#include "transfer_engine.hpp"
+
+#include <atomic>
+#include <shared_mutex>
+
+#include "stats.hpp"
+
+namespace HLVulkan {
+
+    struct TransferBatch {
+        VkDevice device = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        size_t operationCount = 0;
+        std::atomic<bool> complete{false};
+        std::vector<std::shared_ptr<void>> resources;
+
+        // Tickets hold it shared while they use the fence, collect() holds it exclusively to recycle the fence
+        std::shared_mutex fenceMutex;
+    };
+
+    TransferTicket::TransferTicket(std::shared_ptr<TransferBatch> batch) : batch(std::move(batch)) {}
+
+    bool TransferTicket::isComplete() const {
+        if (!batch || batch->complete) {
+            return true;
+        }
+        std::shared_lock<std::shared_mutex> lock(batch->fenceMutex);
+        if (!batch->complete && vkGetFenceStatus(batch->device, batch->fence) == VK_SUCCESS) {
+            batch->complete = true;
+        }
+        return batch->complete;
+    }
+
+    VkResult TransferTicket::wait(uint64_t timeout) const {
+        if (!batch || batch->complete) {
+            return VK_SUCCESS;
+        }
+        // collect() only takes the lock once the fence is signaled, so it never waits long on a waiting ticket
+        std::shared_lock<std::shared_mutex> lock(batch->fenceMutex);
+        if (batch->complete) {
+            return VK_SUCCESS;
+        }
+        VK_CHECK_RET(vkWaitForFences(batch->device, 1, &batch->fence, VK_TRUE, timeout));
+        batch->complete = true;
+        return VK_SUCCESS;
+    }
+
+    // Command buffers are individually reset when recycled and only live for a single submission
+    TransferEngine::TransferEngine(Device device, Queue queue) : device(device), queue(queue), commandPool(device, queue) {}
+
+    VkResult TransferEngine::beginBatch() {
+
+        if (pending) {
+            return VK_SUCCESS;
+        }
+
+        VkCommandBuffer commandBuffer = commandPool.acquireCommandBuffer();
+        if (commandBuffer == VK_NULL_HANDLE) {
+            return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        }
+
+        // Beginning implicitly resets a recycled command buffer
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        VkResult ret;
+        if ((ret = vkBeginCommandBuffer(commandBuffer, &beginInfo)) != VK_SUCCESS) {
+            commandPool.release(commandBuffer);
+            return ret;
+        }
+
+        pending = std::make_shared<TransferBatch>();
+        pending->device = device.logical;
+        pending->commandBuffer = commandBuffer;
+        return VK_SUCCESS;
+    }
+
+    void TransferEngine::flushBarriers() {
+        if (!barriers.empty()) {
+            barriers.record(pending->commandBuffer);
+        }
+    }
+
+    VkResult TransferEngine::copyBuffer(Buffer &srcBuffer, Buffer &dstBuffer) {
+        VK_CHECK_RET(beginBatch());
+        flushBarriers();
+        srcBuffer.recordCopyTo(pending->commandBuffer, dstBuffer);
+        pending->operationCount++;
+        return VK_SUCCESS;
+    }
+
+    VkResult TransferEngine::copyBufferToImage(Buffer &srcBuffer, Image &dstImage, VkImageLayout layout) {
+        VK_CHECK_RET(beginBatch());
+        flushBarriers();
+        dstImage.recordCopyFromBuffer(pending->commandBuffer, layout, srcBuffer);
+        pending->operationCount++;
+        return VK_SUCCESS;
+    }
+
+    VkResult TransferEngine::copyBufferToImage(Buffer &srcBuffer, Image &dstImage, VkImageLayout layout, const std::vector<VkDeviceSize> &levelOffsets) {
+        VK_CHECK_RET(beginBatch());
+        flushBarriers();
+        dstImage.recordCopyFromBuffer(pending->commandBuffer, layout, srcBuffer, levelOffsets);
+        pending->operationCount++;
+        return VK_SUCCESS;
+    }
+
+    VkResult TransferEngine::transitionImageLayout(Image &image, VkImageLayout oldLayout, VkImageLayout newLayout) {
+        VK_CHECK_RET(beginBatch());
+        flushBarriers();
+        VK_CHECK_RET(image.recordTransitionImageLayout(pending->commandBuffer, oldLayout, newLayout));
+        pending->operationCount++;
+        return VK_SUCCESS;
+    }
+
+    VkResult TransferEngine::transition(Buffer &buffer, const ResourceAccess &access) {
+        VK_CHECK_RET(beginBatch());
+        barriers.transition(buffer, access);
+        pending->operationCount++;
+        return VK_SUCCESS;
+    }
+
+    VkResult TransferEngine::transition(Image &image, const ResourceAccess &access) {
+        VK_CHECK_RET(beginBatch());
+        barriers.transition(image, access);
+        pending->operationCount++;
+        return VK_SUCCESS;
+    }
+
+    VkResult TransferEngine::release(Buffer &buffer, uint32_t dstFamily, const ResourceAccess &access) {
+        VK_CHECK_RET(beginBatch());
+        barriers.release(buffer, queue.family, dstFamily, access);
+        pending->operationCount++;
+        return VK_SUCCESS;
+    }
+
+    VkResult TransferEngine::release(Image &image, uint32_t dstFamily, const ResourceAccess &access) {
+        VK_CHECK_RET(beginBatch());
+        barriers.release(image, queue.family, dstFamily, access);
+        pending->operationCount++;
+        return VK_SUCCESS;
+    }
+
+    void TransferEngine::keepAlive(std::shared_ptr<void> resource) {
+        VK_CHECK_FAIL(beginBatch(), "failed to begin transfer batch");
+        pending->resources.push_back(std::move(resource));
+    }
+
+    VkResult TransferEngine::submit(TransferTicket &ticket, const std::vector<VkSemaphore> &signalSemaphores) {
+
+        ticket = TransferTicket();
+        if (!pending) {
+            // The caller waits for the semaphores, so they're signaled even without requests
+            if (signalSemaphores.empty()) {
+                return VK_SUCCESS;
+            }
+            VK_CHECK_RET(beginBatch());
+        }
+
+        flushBarriers();
+        std::shared_ptr<TransferBatch> batch = std::move(pending);
+
+        VkResult ret;
+        if ((ret = vkEndCommandBuffer(batch->commandBuffer)) != VK_SUCCESS) {
+            commandPool.release(batch->commandBuffer);
+            return ret;
+        }
+
+        if (freeFences.empty()) {
+            VkFenceCreateInfo fenceInfo = {};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if ((ret = vkCreateFence(device.logical, &fenceInfo, nullptr, &batch->fence)) != VK_SUCCESS) {
+                commandPool.release(batch->commandBuffer);
+                return ret;
+            }
+        } else {
+            batch->fence = freeFences.back();
+            freeFences.pop_back();
+        }
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch->commandBuffer;
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        HL_VULKAN_STATS_ADD(QUEUE_SUBMIT_CALLS, 1);
+        {
+            std::lock_guard<std::mutex> lock(*queue.mutex);
+            ret = vkQueueSubmit(queue.queue, 1, &submitInfo, batch->fence);
+        }
+        if (ret != VK_SUCCESS) {
+            commandPool.release(batch->commandBuffer);
+            freeFences.push_back(batch->fence);
+            return ret;
+        }
+
+        inFlight.push_back(batch);
+        ticket = TransferTicket(batch);
+
+        // Opportunistically recycle what earlier batches used
+        collect();
+        return VK_SUCCESS;
+    }
+
+    VkResult TransferEngine::submitAndWait() {
+        TransferTicket ticket;
+        VK_CHECK_RET(submit(ticket));
+        VK_CHECK_RET(ticket.wait());
+        collect();
+        return VK_SUCCESS;
+    }
+
+    size_t TransferEngine::collect() {
+
+        auto it = inFlight.begin();
+        while (it != inFlight.end()) {
+            TransferBatch &batch = **it;
+            if (!batch.complete && vkGetFenceStatus(device.logical, batch.fence) != VK_SUCCESS) {
+                ++it;
+                continue;
+            }
+
+            // Outstanding tickets only look at the complete flag from now on
+            {
+                std::unique_lock<std::shared_mutex> lock(batch.fenceMutex);
+                batch.complete = true;
+                vkResetFences(device.logical, 1, &batch.fence);
+                freeFences.push_back(batch.fence);
+                batch.fence = VK_NULL_HANDLE;
+            }
+            commandPool.release(batch.commandBuffer);
+            batch.commandBuffer = VK_NULL_HANDLE;
+            batch.resources.clear();
+            it = inFlight.erase(it);
+        }
+        return inFlight.size();
+    }
+
+    size_t TransferEngine::getPendingCount() const { return pending ? pending->operationCount : 0; }
+
+    uint32_t TransferEngine::getQueueFamily() const { return queue.family; }
+
+    TransferEngine::~TransferEngine() {
+
+        // Requests still pending are flushed rather than dropped
+        if (pending) {
+            VK_CHECK_FAIL(submitAndWait(), "failed to flush pending transfers");
+        }
+        for (const auto &batch : inFlight) {
+            vkWaitForFences(device.logical, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+        }
+        collect();
+
+        for (VkFence fence : freeFences) {
+            vkDestroyFence(device.logical, fence, nullptr);
+        }
+    }
+
+} // namespace HLVulkan
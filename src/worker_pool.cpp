@@ -0,0 +1,47 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+namespace HLVulkan {
+
+    WorkerPool::WorkerPool(size_t threadCount) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        threads.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            threads.emplace_back(&WorkerPool::run, this);
+        }
+    }
+
+    void WorkerPool::run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+    size_t WorkerPool::getThreadCount() const { return threads.size(); }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+} // namespace HLVulkan